@@ -8,6 +8,8 @@ SET @TARGET_HOSTILE_AGGRO_FROM_BOTTOM = 4;  -- Position (TargetArg2) in the thre
 SET @TARGET_HOSTILE_RANDOM = 5;             -- Just any random player on our threat list. TargetArg = max/min range.
 SET @TARGET_HOSTILE_RANDOM_NOT_TOP = 6;     -- Just any random player on our threat list except the current target. TargetArg = max/min range.
 SET @TARGET_PLAYER_DISTANCE = 18;           -- All players in range. TargetArg = max/min range.
+SET @TARGET_PLAYER_DENSEST_CLUSTER = 19;    -- The player in the middle of the biggest group of players. TargetArg = max range (0 = 200), TargetArg2 = group size in yards.
+SET @TARGET_PLAYER_MOST_ALLIES = 20;        -- The player with the most other players within TargetArg2 yards. TargetArg = max range (0 = 200).
 -- ************************************************************************
 
 DROP TABLE IF EXISTS `zone_difficulty_mythicmode_ai`;
@@ -26,5 +28,6 @@ CREATE TABLE `zone_difficulty_mythicmode_ai` (
     `Repetitions` TINYINT NOT NULL DEFAULT 0,       -- 0 = forever, 1 = just once. Room for future counters.
     `Enabled` TINYINT DEFAULT 1,                    -- 0 = disabled, 1 = enabled
 	`TriggeredCast` TINYINT DEFAULT 1,              -- 0 = Not triggered, 1 = Triggered spell cast (no cast time, etc.)
+    `Priority` TINYINT NOT NULL DEFAULT 0,          -- higher first, when several spells are due at once or wait for the current cast to finish
 	`Comment` TEXT
 );
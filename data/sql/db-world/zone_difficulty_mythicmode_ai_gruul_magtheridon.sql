@@ -8,6 +8,8 @@ SET @TARGET_HOSTILE_AGGRO_FROM_BOTTOM = 4;  -- Position (TargetArg2) in the thre
 SET @TARGET_HOSTILE_RANDOM = 5;             -- Just any random player on our threat list. TargetArg = max/min range.
 SET @TARGET_HOSTILE_RANDOM_NOT_TOP = 6;     -- Just any random player on our threat list except the current target. TargetArg = max/min range.
 SET @TARGET_PLAYER_DISTANCE = 18;           -- All players in range. TargetArg = max/min range.
+SET @TARGET_PLAYER_DENSEST_CLUSTER = 19;    -- The player in the middle of the biggest group of players. TargetArg = max range (0 = 200), TargetArg2 = group size in yards.
+SET @TARGET_PLAYER_MOST_ALLIES = 20;        -- The player with the most other players within TargetArg2 yards. TargetArg = max range (0 = 200).
 -- ************************************************************************
 
 DELETE FROM `zone_difficulty_mythicmode_ai` WHERE `CreatureEntry` IN (18831, 18832, 18834, 19044, 19389, 21350, 17257);
@@ -6,6 +6,16 @@
 #include "InstanceScript.h"
 #include "ScriptMgr.h"
 #include "ScriptedGossip.h"
+#include "AsyncCallbackProcessor.h"
+#include "QueryCallback.h"
+#include "ZoneDifficultyTimingWheel.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <utility>
 
 struct ZoneDifficultyNerfData
 {
@@ -20,12 +30,268 @@ struct ZoneDifficultyNerfData
     float MeleeDamageBuffPctHard = 1.0f;
 };
 
+// Final multipliers for one map, phase and mode. Built from ZoneDifficultyNerfData on load.
+struct ZoneDifficultyNerfMultipliers
+{
+    float Healing = 1.0f;
+    float Absorb = 1.0f;
+    float SpellDamage = 1.0f;
+    float MeleeDamage = 1.0f;
+};
+
+// Position of a map's phase slots in the flattened nerf table
+struct ZoneDifficultyNerfMapEntry
+{
+    uint32 FirstSlot = 0;
+    uint32 PhaseCount = 0;      // 0 = map is not tuned
+    uint32 PhaseBitOffset = 0;  // first of the 32 masks in NerfPhaseBitSlots
+    bool AllPhases = false;     // PhaseMask 0 is configured and always matches
+};
+
+// Phase slots are tracked in a 32 bit mask per phase bit
+uint32 const MAX_NERF_PHASE_SLOTS = 32;
+
 struct ZoneDifficulySpellOverrideData
 {
     float NerfPct;
     uint32 ModeMask;    // 1=normal, 64=mythic (bitmask)
 };
 
+/**
+ *  @brief Read-only lookup over SpellNerfOverrides for the unit hooks.
+ *
+ *  Overrides are stored in an open addressing table keyed by (spellId << 32 | mapId).
+ *  A bitset over spell ids sits in front of it, so spells without any override
+ *  are rejected with a single bit test.
+ */
+class ZoneDifficultySpellOverrideIndex
+{
+public:
+    void Build(std::map<uint32, std::map<uint32, ZoneDifficulySpellOverrideData> > const& overrides);
+    [[nodiscard]] bool HasSpell(uint32 spellId) const
+    {
+        uint32 word = spellId >> 6;
+        return word < _spellBits.size() && (_spellBits[word] & (uint64(1) << (spellId & 63)));
+    }
+    [[nodiscard]] ZoneDifficulySpellOverrideData const* Find(uint32 spellId, uint32 mapId) const;
+
+private:
+    struct Slot
+    {
+        uint64 Key = 0;     // 0 = empty, spell id 0 is never stored
+        ZoneDifficulySpellOverrideData Data{};
+    };
+
+    [[nodiscard]] static uint64 MakeKey(uint32 spellId, uint32 mapId) { return (uint64(spellId) << 32) | mapId; }
+    [[nodiscard]] uint64 SlotFor(uint64 key) const { return (key * 0x9E3779B97F4A7C15ULL) >> _shift; }
+
+    std::vector<uint64> _spellBits;
+    std::vector<Slot> _slots;
+    uint8 _shift = 64;
+};
+
+/**
+ *  @brief One pending Mythicmode AI ability of a unit, waiting in the ability wheel of its map.
+ */
+struct ZoneDifficultyMythicAbility
+{
+    ObjectGuid UnitGuid;
+    uint32 Entry = 0;
+    uint32 Index = 0;       // position in the Mythicmode AI program of the entry
+    uint32 Generation = 0;  // abilities of an older generation were cancelled
+    uint8 Priority = 0;     // higher first, when several abilities of a unit are due at once
+};
+
+typedef ZoneDifficultyTimingWheel<ZoneDifficultyMythicAbility> ZoneDifficultyAbilityWheel;
+
+/**
+ *  @brief Everything the module tracks for a single instance. Fields are atomic,
+ *  so map threads can read them while the gossip of another map writes.
+ */
+struct ZoneDifficultyInstanceState
+{
+    std::atomic<bool> MythicmodeOn{ false };
+    std::atomic<uint32> EncounterStartTime{ 0 };  // 0 = no encounter in progress
+    std::atomic<bool> RescalePending{ false };     // creature health is rescaled on the next update of the map
+    // Only touched by the thread updating the map
+    std::unique_ptr<ZoneDifficultyAbilityWheel> AbilityWheel;
+    std::vector<ObjectGuid> ParkedUnits;                    // units with abilities waiting for their cast to finish
+    std::vector<ZoneDifficultyMythicAbility> DueAbilities;  // reused every update
+};
+
+/**
+ *  @brief Per-instance state keyed by instance id.
+ *
+ *  Instance ids are handed out densely by the MapMgr, so the records live in fixed-size
+ *  pages behind a flat directory. Pages are allocated on first write and never moved or
+ *  freed while the world runs, which makes a read two atomic loads without any lock.
+ *  Writers only lock the shard owning the page when it has to be allocated.
+ */
+class ZoneDifficultyInstanceStore
+{
+public:
+    static constexpr uint32 PAGE_BITS = 10;
+    static constexpr uint32 PAGE_SIZE = 1 << PAGE_BITS;
+    static constexpr uint32 MAX_PAGES = 1 << 12;    // 4M instance ids
+    static constexpr uint32 SHARD_COUNT = 16;
+
+    ZoneDifficultyInstanceStore() = default;
+    ZoneDifficultyInstanceStore(ZoneDifficultyInstanceStore const&) = delete;
+    ZoneDifficultyInstanceStore& operator=(ZoneDifficultyInstanceStore const&) = delete;
+    ~ZoneDifficultyInstanceStore();
+
+    [[nodiscard]] ZoneDifficultyInstanceState const* Find(uint32 instanceId) const;
+    [[nodiscard]] ZoneDifficultyInstanceState* Find(uint32 instanceId) { return const_cast<ZoneDifficultyInstanceState*>(std::as_const(*this).Find(instanceId)); };
+    [[nodiscard]] ZoneDifficultyInstanceState* GetOrCreate(uint32 instanceId);
+
+    [[nodiscard]] bool IsMythicmode(uint32 instanceId) const;
+    void SetMythicmode(uint32 instanceId, bool on);
+    [[nodiscard]] uint32 GetEncounterStartTime(uint32 instanceId) const;
+    void SetEncounterStartTime(uint32 instanceId, uint32 startTime);
+    void QueueRescale(uint32 instanceId);
+    [[nodiscard]] bool TakeRescale(uint32 instanceId);
+    void Reset(uint32 instanceId);
+    void ReleaseAbilityWheel(uint32 instanceId);
+
+private:
+    struct Page
+    {
+        std::array<ZoneDifficultyInstanceState, PAGE_SIZE> States;
+    };
+
+    std::array<std::atomic<Page*>, MAX_PAGES> _pages{};
+    std::array<std::mutex, SHARD_COUNT> _shardLocks;
+};
+
+struct ZoneDifficultyEncounterLog
+{
+    uint32 InstanceId = 0;
+    uint32 TimestampStart = 0;
+    uint32 TimestampEnd = 0;
+    uint32 Map = 0;
+    uint32 BossId = 0;
+    uint32 PlayerGuid = 0;
+    uint32 Mode = 0;
+};
+
+struct ZoneDifficultyCompletionLog
+{
+    uint32 Guid = 0;
+    uint8 Type = 0;
+    uint8 Mode = 0;
+};
+
+/**
+ *  @brief Collects encounter and completion log rows from all maps and writes them in batches.
+ *
+ *  Map threads queue the rows of a kill at once. The world thread writes everything queued
+ *  as multi-row statements in a single transaction, as soon as the oldest row waited for
+ *  FlushInterval, so a wave of kills turns into a few statements instead of one per player.
+ */
+class ZoneDifficultyLogWriter
+{
+public:
+    static constexpr std::size_t ROWS_PER_STATEMENT = 500;
+
+    void QueueEncounterLogs(std::vector<ZoneDifficultyEncounterLog> const& rows);
+    void QueueCompletionLogs(std::vector<ZoneDifficultyCompletionLog> const& rows);
+    // Encounter logs of a player which are not flushed yet
+    [[nodiscard]] std::vector<ZoneDifficultyEncounterLog> GetQueuedEncounterLogs(uint32 playerGuid);
+    // Flush if the oldest queued row is due, called by the world thread
+    void Update();
+    void Flush();
+
+    Milliseconds FlushInterval{ 2000 };
+
+private:
+    std::mutex _lock;
+    std::vector<ZoneDifficultyEncounterLog> _encounterLogs;
+    std::vector<ZoneDifficultyCompletionLog> _completionLogs;
+    uint32 _oldestQueuedTime = 0;           // getMSTime() of the first row queued since the last flush
+    std::atomic<bool> _pending{ false };
+};
+
+/**
+ *  @brief Writes the Mythicmode flags of instances to zone_difficulty_instance_saves behind the gossip.
+ *
+ *  Changes only mark the instance dirty. The world thread writes the current flag of every
+ *  dirty instance and deletes the rows of expired instances in one transaction, once the
+ *  oldest change waited for FlushInterval. Toggling an instance any number of times in
+ *  between results in a single row written.
+ */
+class ZoneDifficultyInstanceSaves
+{
+public:
+    static constexpr std::size_t ROWS_PER_STATEMENT = 1000;
+
+    void QueueSave(uint32 instanceId);
+    void QueueDelete(uint32 instanceId);
+    // Flush if the oldest queued change is due, called by the world thread
+    void Update();
+    void Flush();
+    // Write a single instance right away, e.g. when it is unloaded. Other instances keep waiting.
+    void Flush(uint32 instanceId);
+    static void Delete(std::set<uint32> const& instanceIds);
+
+    Milliseconds FlushInterval{ 2000 };
+
+private:
+    void Queue(std::set<uint32>& add, std::set<uint32>& remove, uint32 instanceId);
+    static void AppendDeletes(CharacterDatabaseTransaction trans, std::set<uint32> const& instanceIds);
+
+    std::mutex _lock;
+    std::set<uint32> _saves;
+    std::set<uint32> _deletes;
+    uint32 _oldestQueuedTime = 0;           // getMSTime() of the first change queued since the last flush
+    std::atomic<bool> _pending{ false };
+};
+
+// Maps counted by HasCompletedFullTier, each has a fixed slot with a mask of the killed bosses
+constexpr uint8 MYTHIC_PROGRESS_SLOTS = 22;
+typedef std::array<uint64, MYTHIC_PROGRESS_SLOTS> ZoneDifficultyProgressMasks;
+
+/**
+ *  @brief Mythicmode boss kills of the players who are online.
+ *
+ *  A player's kills are queried asynchronously on login and dropped on logout, kills made
+ *  while online are added as they happen. Reads of a player whose query is still running
+ *  load the kills on the spot. Kills the LogWriter did not flush yet are taken from its queue,
+ *  so a relog right after a kill does not lose it.
+ */
+class ZoneDifficultyProgressCache
+{
+public:
+    void Load(uint32 playerGuid);
+    void Evict(uint32 playerGuid);
+    void MarkKilled(uint32 playerGuid, uint32 mapId, uint32 bossId);
+    [[nodiscard]] bool HasKilledAll(uint32 playerGuid, ZoneDifficultyProgressMasks const& required);
+    // Apply finished queries, called by the world thread
+    void Update();
+
+private:
+    struct Progress
+    {
+        bool Loaded = false;
+        ZoneDifficultyProgressMasks Killed{};
+    };
+
+    void Apply(uint32 playerGuid, QueryResult result);
+    static void Merge(Progress& progress, QueryResult const& result);
+    static void MergeQueued(Progress& progress, std::vector<ZoneDifficultyEncounterLog> const& logs);
+    static void SetKilled(Progress& progress, uint32 mapId, uint32 bossId);
+    [[nodiscard]] static int32 GetSlot(uint32 mapId);
+
+    std::mutex _lock;
+    std::unordered_map<uint32, Progress> _players;
+    QueryCallbackProcessor _queries;
+};
+
+struct ZoneDifficultyScaledHealth
+{
+    uint32 ScaledBaseHealth = 0;
+    bool HasOverride = false;   // CreatureOverrides has an entry for the creature
+};
+
 struct ZoneDifficultyMythicmodeMapData
 {
     uint32 EncounterEntry;
@@ -42,20 +308,48 @@ struct ZoneDifficultyRewardData
     int32 Achievement;
 };
 
-struct ZoneDifficultyHAI
+// Pre-decoded flags of a compiled Mythicmode AI ability
+uint8 const MYTHIC_ABILITY_FLAG_BP0 = 0x01;         // Spellbp0 is set
+uint8 const MYTHIC_ABILITY_FLAG_BP1 = 0x02;         // Spellbp1 is set
+uint8 const MYTHIC_ABILITY_FLAG_BP2 = 0x04;         // Spellbp2 is set
+uint8 const MYTHIC_ABILITY_FLAG_REPEAT = 0x08;      // Repetitions is 0, rescheduled after Cooldown
+uint8 const MYTHIC_ABILITY_FLAG_TRIGGERED = 0x10;   // TriggeredCast
+uint8 const MYTHIC_ABILITY_FLAG_FALLBACK = 0x20;    // fall back to the victim if it is within MinRange..MaxRange
+
+uint8 const MYTHIC_ABILITY_BP_MASK = MYTHIC_ABILITY_FLAG_BP0 | MYTHIC_ABILITY_FLAG_BP1 | MYTHIC_ABILITY_FLAG_BP2;
+
+/**
+ *  @brief One validated row of zone_difficulty_mythicmode_ai, compiled on load.
+ *
+ *  Everything MythicmodeEvent needs is resolved up front, so firing an ability
+ *  reads a single cache line.
+ */
+struct alignas(64) ZoneDifficultyHAI
+{
+    SpellInfo const* Spell = nullptr;
+    int32 BasePoints[3] = { 0, 0, 0 };
+    float SelectRange = 0.0f;   // range handed to the target selection of Target
+    float MinRange = 0.0f;      // victim fallback window
+    float MaxRange = 0.0f;
+    Milliseconds Delay{ 0 };
+    Milliseconds Cooldown{ 0 };
+    TriggerCastFlags TriggerFlags = TRIGGERED_NONE;
+    uint32 SpellId = 0;
+    uint8 Chance = 0;
+    uint8 Target = 0;
+    uint8 ThreatPosition = 0;   // position in the threat list for the aggro targets
+    uint8 Radius = 0;           // cluster radius for the cluster targets
+    uint8 Priority = 0;
+    uint8 Flags = 0;            // MYTHIC_ABILITY_FLAG_*
+};
+
+static_assert(sizeof(ZoneDifficultyHAI) == 64, "A compiled Mythicmode AI ability has to fit into one cache line");
+
+// Position of a creature's abilities in ZoneDifficultySnapshot::MythicmodeAbilities
+struct ZoneDifficultyAbilityProgram
 {
-    uint8 Chance;
-    uint32 Spell;
-    int32 Spellbp0;
-    int32 Spellbp1;
-    int32 Spellbp2;
-    uint8 Target;
-    int8 TargetArg;
-    uint8 TargetArg2;
-    Milliseconds Delay;
-    Milliseconds Cooldown;
-    uint8 Repetitions;
-    bool TriggeredCast;
+    uint32 First = 0;
+    uint32 Count = 0;
 };
 
 struct VendorSelectionData
@@ -72,6 +366,7 @@ struct CreatureOverrideData
 
 int32 const DUEL_INDEX = 0x7FFFFFFF;
 int32 const DUEL_AREA = 2402;       // Forbidding Sea (Wetlands)
+uint32 const DUEL_MAP = 0;          // Eastern Kingdoms, holds DUEL_AREA
 
 uint32 const NPC_TEXT_LEADER_NORMAL = 91301;
 uint32 const NPC_TEXT_OTHER = 91302;
@@ -88,8 +383,23 @@ uint32 const NPC_TEXT_SCORE = 91311;
 int32 const MODE_NORMAL = 1;
 int32 const MODE_HARD = 64;
 
-// EVENT_GROUP is used for unit->m_Events.AddEventAtOffset
-uint8 const EVENT_GROUP = 64;
+// Mode index into the flattened nerf table
+uint8 const NERF_MODE_INDEX_NORMAL = 0;
+uint8 const NERF_MODE_INDEX_MYTHIC = 1;
+uint8 const NERF_MODE_INDEX_MAX = 2;
+
+// Per-spell classification, computed once from the spell store at startup
+uint8 const SPELL_CLASS_EXEMPT_HEAL = 0x01;     // leech, bandage or not affected by vulnerability: heals are never nerfed
+uint8 const SPELL_CLASS_DOT = 0x02;             // has a periodic damage aura
+uint8 const SPELL_CLASS_SCHOOL_ABSORB = 0x04;   // applies a school absorb aura
+uint8 const SPELL_CLASS_NO_IMMUNITIES = 0x08;   // SPELL_ATTR0_NO_IMMUNITIES (potions)
+
+// Per-map behavior bits, rebuilt with every snapshot
+uint8 const MAP_FLAG_NERF = 0x01;               // has rows in zone_difficulty_info
+uint8 const MAP_FLAG_DUEL_NERF = 0x02;          // duels in DUEL_AREA are nerfed
+uint8 const MAP_FLAG_MYTHIC = 0x04;             // has Mythicmode loot, so Mythicmode can be played
+uint8 const MAP_FLAG_DISALLOWED_BUFFS = 0x08;   // has rows in zone_difficulty_disallowed_buffs
+uint8 const MAP_FLAG_CREATURE_SCALING = 0x10;   // creature health is scaled
 
 uint32 const ITEMTYPE_MISC = 1;
 uint32 const ITEMTYPE_CLOTH = 2;
@@ -106,11 +416,16 @@ uint32 const TARGET_HOSTILE_AGGRO_FROM_BOTTOM = 4;   // count TargetArg lowest a
 uint32 const TARGET_HOSTILE_RANDOM = 5;              // any random player from the threat list
 uint32 const TARGET_HOSTILE_RANDOM_NOT_TOP = 6;      // any random player from the threat list except the current target
 uint32 const TARGET_PLAYER_DISTANCE = 18;            // a random player within TargetArg range
+uint32 const TARGET_PLAYER_DENSEST_CLUSTER = 19;     // the center of the biggest group of players within TargetArg range, grouped in TargetArg2 yard squares
+uint32 const TARGET_PLAYER_MOST_ALLIES = 20;         // the player within TargetArg range with the most other players within TargetArg2 yards
 
 const std::string REWARD_MAIL_SUBJECT = "Chromie's Reward for you";
 const std::string REWARD_MAIL_BODY = "Enjoy your new item!";
 
 const std::string ModZoneDifficultyString = "mod-zone-difficulty#";
+// Player setting sources, built once instead of on every lookup
+const std::string ModZoneDifficultyScoreSetting = ModZoneDifficultyString + "score";
+const std::string ModZoneDifficultyCompletionSetting = ModZoneDifficultyString + "ct";
 
 enum ZoneDifficultySettings
 {
@@ -153,6 +468,93 @@ enum Misc
     NPC_REWARD_CHROMIE    = 1128002,
 };
 
+/**
+ *  @brief Mythicmode score of an online player, indexed by the score types of ZoneDifficultySettings.
+ *
+ *  Kept in the player's CustomData. It is read from the player settings once on login,
+ *  changed in place and written back into the settings when the player is saved or logs out.
+ */
+class ZoneDifficultyScoreLedger : public DataMap::Base
+{
+public:
+    // The ledger of the player, loaded from the settings on first use
+    static ZoneDifficultyScoreLedger& Get(Player* player);
+    // Write the changed scores back into the player settings and drop the ledger on logout
+    static void Save(Player* player, bool logout);
+
+    [[nodiscard]] uint32 GetScore(uint32 type) const { return type < TYPE_MAX_TIERS ? _scores[type] : 0; }
+    void SetScore(uint32 type, uint32 score);
+
+private:
+    void Load(Player* player);
+
+    std::array<uint32, TYPE_MAX_TIERS> _scores{};
+    uint32 _changed = 0;    // bit per score type
+};
+
+/**
+ *  @brief World-side tuning data loaded from the zone_difficulty_* world tables.
+ *
+ *  LoadMapDifficultySettings builds a new snapshot off to the side and publishes it once
+ *  it is complete. A published snapshot is never modified, so the hooks can read it
+ *  without locks while a `.reload config` is running.
+ */
+struct ZoneDifficultySnapshot
+{
+    void BuildNerfTable();
+    void BuildMapFlags();
+    void BuildTierRequirements();
+    [[nodiscard]] bool HasMapFlag(uint32 mapId, uint8 flags) const { return mapId < MapFlags.size() && (MapFlags[mapId] & flags); };
+    [[nodiscard]] bool ShouldNerfMap(uint32 mapId) const { return mapId < NerfMaps.size() && NerfMaps[mapId].PhaseCount; };
+    // Whether the tuning of the map depends on the phase of the creature at all
+    [[nodiscard]] bool HasPhasedNerf(uint32 mapId) const { return ShouldNerfMap(mapId) && !NerfMaps[mapId].AllPhases; };
+    [[nodiscard]] int32 GetLowestMatchingPhase(uint32 mapId, uint32 phaseMask) const;
+    [[nodiscard]] int32 GetLowestMatchingPhaseSlot(ZoneDifficultyNerfMapEntry const& entry, uint32 phaseMask) const;
+    [[nodiscard]] std::vector<ZoneDifficultyRewardData> const* GetRewards(uint32 category, uint32 itemType) const;
+    [[nodiscard]] ZoneDifficultyRewardData const* GetReward(uint32 category, uint32 itemType, uint32 counter) const;
+    [[nodiscard]] ZoneDifficultyRewardData const* GetTierReward(uint32 category) const;
+    [[nodiscard]] std::span<ZoneDifficultyHAI const> GetMythicProgram(uint32 entry) const;
+    [[nodiscard]] ZoneDifficultyHAI const* GetMythicAbility(uint32 entry, uint32 index) const;
+
+    uint32 Version{ 0 };
+
+    std::vector<uint32> DailyHeroicQuests;
+    std::map<uint32, uint32> HeroicTBCQuestMapList;
+    std::map<uint32, uint8> EncounterCounter;
+    std::map<uint32, uint8> Expansion;
+    std::map<uint32, CreatureOverrideData> CreatureOverrides;
+    std::map<uint32, std::string> ItemIcons;
+    std::map<uint8, ZoneDifficultyRewardData> TierRewards;
+    // Bosses to kill for a full tier by category, only for tiers where every map has an EncounterCounter
+    std::map<uint8, ZoneDifficultyProgressMasks> TierRequirements;
+
+    typedef std::map<uint32, std::map<uint32, ZoneDifficultyNerfData> > ZoneDifficultyNerfDataMap;
+    ZoneDifficultyNerfDataMap NerfInfo;
+    // Flattened copy of NerfInfo for the unit hooks. NerfMaps is indexed by map id,
+    // NerfTable by (FirstSlot + phase slot) * NERF_MODE_INDEX_MAX + mode.
+    std::vector<ZoneDifficultyNerfMapEntry> NerfMaps;
+    std::vector<uint32> NerfPhaseKeys;
+    // For every phase bit of a map: mask of the phase slots whose PhaseMask contains that bit
+    std::vector<uint32> NerfPhaseBitSlots;
+    std::vector<ZoneDifficultyNerfMultipliers> NerfTable;
+    ZoneDifficultyNerfMultipliers DuelNerf;
+    bool DuelNerfEnabled{ true };
+    typedef std::map<uint32, std::map<uint32, ZoneDifficulySpellOverrideData> > ZoneDifficultySpellNerfMap;
+    ZoneDifficultySpellNerfMap SpellNerfOverrides;
+    ZoneDifficultySpellOverrideIndex SpellOverrideIndex;
+    typedef std::map<uint32, std::vector<uint32> > ZoneDifficultyDisablesMap;
+    ZoneDifficultyDisablesMap DisallowedBuffs;
+    std::vector<uint8> MapFlags;    // MAP_FLAG_* indexed by map id
+    typedef std::map<uint32, std::vector<ZoneDifficultyMythicmodeMapData> > ZoneDifficultyMythicmodeLootMap;
+    ZoneDifficultyMythicmodeLootMap MythicmodeLoot;
+    typedef std::map<uint32, std::map<uint32, std::vector<ZoneDifficultyRewardData> > > ZoneDifficultyRewardMap;
+    ZoneDifficultyRewardMap Rewards;
+    // The compiled programs of all creatures back to back, MythicmodeAI points into it by creature entry
+    std::vector<ZoneDifficultyHAI> MythicmodeAbilities;
+    typedef std::unordered_map<uint32, ZoneDifficultyAbilityProgram> ZoneDifficultyHAIMap;
+    ZoneDifficultyHAIMap MythicmodeAI;
+};
+
 class ZoneDifficulty
 {
 public:
@@ -160,8 +562,10 @@ public:
 
     void LoadMapDifficultySettings();
     void SaveMythicmodeInstanceData(uint32 instanceId);
-    void LoadMythicmodeInstanceData();
-    void LoadMythicmodeScoreData();
+    void LoadCharacterData();
+    uint64 LoadMythicmodeInstanceData();
+    uint64 LoadMythicmodeScoreData();
+    void LoadSpellClasses();
     void SendWhisperToRaid(std::string message, Creature* creature, Player* player);
     std::string GetItemTypeString(uint32 type);
     std::string GetContentTypeString(uint32 type);
@@ -170,20 +574,40 @@ public:
     void SendItem(Player* player, ZoneDifficultyRewardData data);
     std::list<Unit*> GetTargetList(Unit* unit, uint32 entry, uint32 key);
     void MythicmodeEvent(Unit* unit, uint32 entry, uint32 key);
-    bool HasNormalMode(int8 mode) { return (mode & MODE_NORMAL) == MODE_NORMAL; }
-    bool HasMythicmode(int8 mode) { return (mode & MODE_HARD) == MODE_HARD; }
+    void ScheduleMythicAbility(Unit* unit, uint32 entry, uint32 index, Milliseconds delay);
+    void CancelMythicAbilities(Unit* unit);
+    void ParkMythicAbility(Unit* unit, uint32 entry, uint32 index);
+    void UpdateMythicAbilities(Map* map);
+    void FireMythicAbilities(Map* map, std::vector<ZoneDifficultyMythicAbility>& abilities);
+    static bool HasNormalMode(int8 mode) { return (mode & MODE_NORMAL) == MODE_NORMAL; }
+    static bool HasMythicmode(int8 mode) { return (mode & MODE_HARD) == MODE_HARD; }
     bool HasCompletedFullTier(uint32 category, uint32 playerGUID);
-    bool OverrideModeMatches(uint32 instanceId, uint32 spellId, uint32 mapId);
+    [[nodiscard]] bool OverrideModeMatches(uint32 instanceId, ZoneDifficulySpellOverrideData const& data) const;
     [[nodiscard]] bool CheckCompletionStatus(Creature* creature, Player* player, uint32 category) const;
     [[nodiscard]] bool IsValidNerfTarget(Unit* target);
     [[nodiscard]] bool VectorContainsUint32(std::vector<uint32> vec, uint32 element);
     [[nodiscard]] bool IsMythicmodeMap(uint32 mapid);
     [[nodiscard]] bool ShouldNerfInDuels(Unit* target);
-    [[nodiscard]] bool ShouldNerfMap(uint32 mapId) { return NerfInfo.find(mapId) != NerfInfo.end(); };
-    [[nodiscard]] int32 GetLowestMatchingPhase(uint32 mapId, uint32 phaseMask);
+    [[nodiscard]] bool ShouldNerfMap(uint32 mapId) const { return GetSnapshot().ShouldNerfMap(mapId); };
+    [[nodiscard]] bool IsMythicmodeInstance(uint32 instanceId) const { return InstanceStates.IsMythicmode(instanceId); };
+    [[nodiscard]] int32 GetLowestMatchingPhase(uint32 mapId, uint32 phaseMask) const { return GetSnapshot().GetLowestMatchingPhase(mapId, phaseMask); };
+    [[nodiscard]] ZoneDifficultyNerfMultipliers const* GetNerfMultipliers(Unit* target) const;
+    [[nodiscard]] uint8 GetSpellClass(uint32 spellId) const { return spellId < SpellClasses.size() ? SpellClasses[spellId] : 0; };
     void RewardItem(Player* player, uint8 category, uint8 itemType, uint8 counter, Creature* creature, uint32 itemEntry);
     void LogAndAnnounceKill(Map* map, bool isMythic);
     void ProcessCreatureDeath(Map* map, uint32 entry);
+    bool ScaleCreatureHealth(Creature* creature, bool force);
+    [[nodiscard]] ZoneDifficultyScaledHealth const& GetScaledBaseHealth(CreatureTemplate const* creatureTemplate, uint8 level, bool isMythic) const;
+    uint32 RescaleInstanceCreatures(Map* map);
+    void ProcessPendingRescale(Map* map);
+
+    /**
+     *  @brief The tuning data pinned by the calling thread. Only valid until the thread pins
+     *  again, so do not keep references across map updates.
+     */
+    [[nodiscard]] ZoneDifficultySnapshot const& GetSnapshot() const;
+    void PinSnapshot() const;
+    void PublishSnapshot(std::shared_ptr<ZoneDifficultySnapshot> snapshot);
 
     bool IsEnabled{ false };
     bool IsDebugInfoEnabled{ false };
@@ -191,36 +615,27 @@ public:
     bool MythicmodeEnable{ false };
     bool MythicmodeInNormalDungeons{ false };
     bool UseVendorInterface{ false };
+    bool SpellBuffOnlyBosses{ false };
+    bool MeleeBuffOnlyBosses{ false };
     bool IsBlackTempleDone{ false };
-    std::vector<uint32> DailyHeroicQuests;
-    std::map<uint32, uint32> HeroicTBCQuestMapList;
-    std::map<uint32, uint8> EncounterCounter;
-    std::map<uint32, uint8> Expansion;
-    std::map<uint32, CreatureOverrideData> CreatureOverrides;
-    std::map<uint32, uint32> EncountersInProgress;
-    std::map<uint32, std::string> ItemIcons;
-    std::map<uint8, ZoneDifficultyRewardData> TierRewards;
+    std::string TuningCacheFile;    // empty = always load the tuning data from the world tables
+    ZoneDifficultyNerfMultipliers const NoNerf{};
+    std::vector<uint8> SpellClasses;    // SPELL_CLASS_* flags indexed by spell id
+    std::atomic<uint32> ConfigGeneration{ 0 };  // bumped on every config (re)load, invalidates derived caches
 
-    typedef std::map<uint32, std::map<uint32, ZoneDifficultyNerfData> > ZoneDifficultyNerfDataMap;
-    ZoneDifficultyNerfDataMap NerfInfo;
-    typedef std::map<uint32, std::map<uint32, ZoneDifficulySpellOverrideData> > ZoneDifficultySpellNerfMap;
-    ZoneDifficultySpellNerfMap SpellNerfOverrides;
-    typedef std::map<uint32, std::vector<uint32> > ZoneDifficultyDisablesMap;
-    ZoneDifficultyDisablesMap DisallowedBuffs;
-    typedef std::map<uint32, bool> ZoneDifficultyMythicmodeInstDataMap;
-    ZoneDifficultyMythicmodeInstDataMap MythicmodeInstanceData;
-    typedef std::map<uint32, std::vector<ZoneDifficultyMythicmodeMapData> > ZoneDifficultyMythicmodeLootMap;
-    ZoneDifficultyMythicmodeLootMap MythicmodeLoot;
+    ZoneDifficultyInstanceStore InstanceStates;
+    ZoneDifficultyLogWriter LogWriter;
+    ZoneDifficultyInstanceSaves InstanceSaves;
+    ZoneDifficultyProgressCache Progress;
     typedef std::map<uint32, std::map<uint32, uint32> > ZoneDifficultyDualUintMap;
     ZoneDifficultyDualUintMap MythicmodeScore; // Deprecated, to be removed.
-    typedef std::map<uint32, std::map<uint32, std::vector<ZoneDifficultyRewardData> > > ZoneDifficultyRewardMap;
-    ZoneDifficultyRewardMap Rewards;
-    typedef std::map<uint32, std::vector<ZoneDifficultyHAI> > ZoneDifficultyHAIMap;
-    ZoneDifficultyHAIMap MythicmodeAI;
-    typedef std::map<uint32, std::map<uint32, std::map<uint32, bool> > > ZoneDifficultyEncounterLogMap;
-    ZoneDifficultyEncounterLogMap Logs;
     typedef std::unordered_map<ObjectGuid, VendorSelectionData> ZoneDifficultyVendorSelectionMap;
     ZoneDifficultyVendorSelectionMap SelectionCache;
+
+private:
+    std::shared_ptr<ZoneDifficultySnapshot const> _snapshot{ std::make_shared<ZoneDifficultySnapshot const>() };
+    std::atomic<uint32> _snapshotVersion{ 0 };
+    mutable std::mutex _snapshotLock;
 };
 
 #define sZoneDifficulty ZoneDifficulty::instance()
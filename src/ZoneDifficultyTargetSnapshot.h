@@ -0,0 +1,318 @@
+#ifndef DEF_ZONEDIFFICULTY_TARGETSNAPSHOT_H
+#define DEF_ZONEDIFFICULTY_TARGETSNAPSHOT_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+/**
+ *  @brief Fixed-capacity list of indices into a ZoneDifficultyTargetSnapshot, filled by its filters.
+ */
+template<uint32_t Capacity>
+struct ZoneDifficultyCandidateSet
+{
+    std::array<uint16_t, Capacity> Indices;
+    uint32_t Count = 0;
+
+    [[nodiscard]] uint16_t const* begin() const { return Indices.data(); }
+    [[nodiscard]] uint16_t const* end() const { return Indices.data() + Count; }
+};
+
+/**
+ *  @brief Positions of a set of targets, stored as one array per coordinate.
+ *
+ *  Range checks over all targets run as a flat loop over the arrays, which the compiler
+ *  can vectorize, instead of chasing one unit after the other. Holds up to Capacity
+ *  targets, Add refuses the rest.
+ *
+ *  Only depends on the standard library, so it can be used outside of the worldserver.
+ */
+template<class T, uint32_t Capacity>
+class ZoneDifficultyTargetSnapshot
+{
+public:
+    static_assert(Capacity <= UINT16_MAX + 1, "Candidate indices are 16 bit");
+
+    void Clear() { _size = 0; }
+
+    /**
+     *  @brief Append a target. radius is added to the range of every check against it.
+     *  @return false if the snapshot is full.
+     */
+    bool Add(T const& target, float x, float y, float z, float radius)
+    {
+        if (_size == Capacity)
+            return false;
+
+        _targets[_size] = target;
+        _x[_size] = x;
+        _y[_size] = y;
+        _z[_size] = z;
+        _radius[_size] = radius;
+        ++_size;
+        return true;
+    }
+
+    /**
+     *  @brief Collect the targets closer than range + their radius to the given point, in insertion order.
+     */
+    void FilterWithin(float x, float y, float z, float range, ZoneDifficultyCandidateSet<Capacity>& candidates) const
+    {
+        // First pass has no branches and no stores depending on earlier iterations
+        for (uint32_t i = 0; i < _size; ++i)
+        {
+            float dx = _x[i] - x;
+            float dy = _y[i] - y;
+            float dz = _z[i] - z;
+            float reach = range + _radius[i];
+            _inside[i] = (dx * dx + dy * dy + dz * dz) < reach * reach;
+        }
+
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < _size; ++i)
+        {
+            candidates.Indices[count] = uint16_t(i);
+            count += _inside[i];
+        }
+
+        candidates.Count = count;
+    }
+
+    [[nodiscard]] T const& operator[](uint32_t index) const { return _targets[index]; }
+    [[nodiscard]] float X(uint32_t index) const { return _x[index]; }
+    [[nodiscard]] float Y(uint32_t index) const { return _y[index]; }
+    [[nodiscard]] float Z(uint32_t index) const { return _z[index]; }
+    [[nodiscard]] uint32_t Size() const { return _size; }
+
+private:
+    alignas(32) std::array<float, Capacity> _x;
+    alignas(32) std::array<float, Capacity> _y;
+    alignas(32) std::array<float, Capacity> _z;
+    alignas(32) std::array<float, Capacity> _radius;
+    alignas(32) mutable std::array<uint8_t, Capacity> _inside;
+    std::array<T, Capacity> _targets;
+    uint32_t _size = 0;
+};
+
+/**
+ *  @brief Buckets a candidate set of a ZoneDifficultyTargetSnapshot into square cells on the x/y plane.
+ *
+ *  With the cell size equal to the radius of interest, every neighbor of a target lies in its
+ *  own or one of the 8 surrounding cells, so cluster queries only look at close targets
+ *  instead of comparing every pair.
+ */
+template<uint32_t Capacity>
+class ZoneDifficultyTargetGrid
+{
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    template<class T>
+    void Build(ZoneDifficultyTargetSnapshot<T, Capacity> const& snapshot, ZoneDifficultyCandidateSet<Capacity> const& candidates, float cellSize)
+    {
+        // Forget the cells of the previous build only, the table itself is never walked
+        for (uint32_t i = 0; i < _cellCount; ++i)
+            _slots[_cells[i].Slot] = NONE;
+
+        _cellCount = 0;
+        _memberCount = 0;
+        _cellSize = cellSize;
+
+        for (uint16_t index : candidates)
+        {
+            uint32_t member = _memberCount++;
+            _index[member] = index;
+            _x[member] = snapshot.X(index);
+            _y[member] = snapshot.Y(index);
+            _z[member] = snapshot.Z(index);
+            _cellX[member] = CellOf(_x[member]);
+            _cellY[member] = CellOf(_y[member]);
+
+            uint32_t cell = FindOrAddCell(_cellX[member], _cellY[member]);
+            _next[member] = NONE;
+            if (_cells[cell].Last != NONE)
+                _next[_cells[cell].Last] = member;
+            else
+                _cells[cell].First = member;
+            _cells[cell].Last = member;
+            ++_cells[cell].Count;
+        }
+    }
+
+    /**
+     *  @brief The snapshot index of the target closest to the center of the most populated 3x3 block of cells, NONE if empty.
+     *  A group straddling a cell border still counts as one group.
+     */
+    [[nodiscard]] uint32_t DensestCluster() const
+    {
+        uint32_t best = NONE;
+        uint32_t bestCount = 0;
+        for (uint32_t cell = 0; cell < _cellCount; ++cell)
+        {
+            uint32_t count = 0;
+            ForEachNeighborCell(cell, [&](uint32_t neighbor) { count += _cells[neighbor].Count; });
+            if (best == NONE || count > bestCount)
+            {
+                best = cell;
+                bestCount = count;
+            }
+        }
+
+        if (best == NONE)
+            return NONE;
+
+        float centerX = 0.0f;
+        float centerY = 0.0f;
+        float centerZ = 0.0f;
+        ForEachNeighborCell(best, [&](uint32_t neighbor)
+        {
+            for (uint32_t member = _cells[neighbor].First; member != NONE; member = _next[member])
+            {
+                centerX += _x[member];
+                centerY += _y[member];
+                centerZ += _z[member];
+            }
+        });
+
+        float count = float(bestCount);
+        centerX /= count;
+        centerY /= count;
+        centerZ /= count;
+
+        uint32_t closest = NONE;
+        float closestDist = 0.0f;
+        ForEachNeighborCell(best, [&](uint32_t neighbor)
+        {
+            for (uint32_t member = _cells[neighbor].First; member != NONE; member = _next[member])
+            {
+                float dist = DistSq(member, centerX, centerY, centerZ);
+                if (closest == NONE || dist < closestDist)
+                {
+                    closest = member;
+                    closestDist = dist;
+                }
+            }
+        });
+
+        return _index[closest];
+    }
+
+    /**
+     *  @brief The snapshot index of the target with the most other targets closer than radius, NONE if empty.
+     *  radius must not exceed the cell size the grid was built with.
+     */
+    [[nodiscard]] uint32_t MostNeighbors(float radius) const
+    {
+        float radiusSq = radius * radius;
+        uint32_t best = NONE;
+        uint32_t bestCount = 0;
+
+        for (uint32_t member = 0; member < _memberCount; ++member)
+        {
+            uint32_t count = 0;
+            for (int32_t dx = -1; dx <= 1; ++dx)
+            {
+                for (int32_t dy = -1; dy <= 1; ++dy)
+                {
+                    uint32_t cell = FindCell(_cellX[member] + dx, _cellY[member] + dy);
+                    if (cell == NONE)
+                        continue;
+
+                    for (uint32_t other = _cells[cell].First; other != NONE; other = _next[other])
+                        count += other != member && DistSq(other, _x[member], _y[member], _z[member]) <= radiusSq;
+                }
+            }
+
+            if (best == NONE || count > bestCount)
+            {
+                best = member;
+                bestCount = count;
+            }
+        }
+
+        return best == NONE ? NONE : _index[best];
+    }
+
+private:
+    static constexpr uint32_t TABLE_SIZE = [] { uint32_t size = 1; while (size < Capacity * 2) size <<= 1; return size; }();
+
+    struct Cell
+    {
+        int32_t X = 0;
+        int32_t Y = 0;
+        uint32_t Slot = 0;
+        uint32_t First = NONE;
+        uint32_t Last = NONE;
+        uint32_t Count = 0;
+    };
+
+    [[nodiscard]] int32_t CellOf(float coordinate) const { return int32_t(std::floor(coordinate / _cellSize)); }
+
+    [[nodiscard]] float DistSq(uint32_t member, float x, float y, float z) const
+    {
+        float dx = _x[member] - x;
+        float dy = _y[member] - y;
+        float dz = _z[member] - z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    [[nodiscard]] static uint32_t SlotFor(int32_t x, int32_t y)
+    {
+        uint64_t key = (uint64_t(uint32_t(x)) << 32) | uint32_t(y);
+        return uint32_t((key * 0x9E3779B97F4A7C15ULL) >> 32) & (TABLE_SIZE - 1);
+    }
+
+    [[nodiscard]] uint32_t FindCell(int32_t x, int32_t y) const
+    {
+        for (uint32_t slot = SlotFor(x, y); _slots[slot] != NONE; slot = (slot + 1) & (TABLE_SIZE - 1))
+            if (_cells[_slots[slot]].X == x && _cells[_slots[slot]].Y == y)
+                return _slots[slot];
+
+        return NONE;
+    }
+
+    // Calls fn with the cell itself and every populated cell around it
+    template<class Fn>
+    void ForEachNeighborCell(uint32_t cell, Fn&& fn) const
+    {
+        for (int32_t dx = -1; dx <= 1; ++dx)
+        {
+            for (int32_t dy = -1; dy <= 1; ++dy)
+            {
+                uint32_t neighbor = FindCell(_cells[cell].X + dx, _cells[cell].Y + dy);
+                if (neighbor != NONE)
+                    fn(neighbor);
+            }
+        }
+    }
+
+    uint32_t FindOrAddCell(int32_t x, int32_t y)
+    {
+        uint32_t slot = SlotFor(x, y);
+        for (; _slots[slot] != NONE; slot = (slot + 1) & (TABLE_SIZE - 1))
+            if (_cells[_slots[slot]].X == x && _cells[_slots[slot]].Y == y)
+                return _slots[slot];
+
+        uint32_t cell = _cellCount++;
+        _cells[cell] = { x, y, slot, NONE, NONE, 0 };
+        _slots[slot] = cell;
+        return cell;
+    }
+
+    std::array<uint32_t, TABLE_SIZE> _slots = [] { std::array<uint32_t, TABLE_SIZE> slots; slots.fill(NONE); return slots; }();
+    std::array<Cell, Capacity> _cells;
+    uint32_t _cellCount = 0;
+
+    // Members in candidate order
+    std::array<uint16_t, Capacity> _index;
+    std::array<float, Capacity> _x;
+    std::array<float, Capacity> _y;
+    std::array<float, Capacity> _z;
+    std::array<int32_t, Capacity> _cellX;
+    std::array<int32_t, Capacity> _cellY;
+    std::array<uint32_t, Capacity> _next;
+    uint32_t _memberCount = 0;
+    float _cellSize = 1.0f;
+};
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef DEF_ZONEDIFFICULTY_TIMINGWHEEL_H
+#define DEF_ZONEDIFFICULTY_TIMINGWHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  @brief Hierarchical timing wheel holding small payloads until their due time.
+ *
+ *  Four levels of 64 slots each, level 0 advancing by TickMs. Entries further out than
+ *  the top level can reach wait in an overflow list. Entries live in one node pool and
+ *  are chained by index, so scheduling and firing only allocate when the pool has to grow.
+ *  Schedule hands out a Handle (node index plus generation), which cancels the entry in O(1)
+ *  and turns into a no-op once the entry fired or was cancelled.
+ *
+ *  Only depends on the standard library, so it can be used outside of the worldserver.
+ */
+template<class T, uint32_t TickMs = 10>
+class ZoneDifficultyTimingWheel
+{
+public:
+    static constexpr uint32_t LEVELS = 4;
+    static constexpr uint32_t SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint32_t OVERFLOW_BUCKET = LEVELS * SLOTS;
+
+    struct Handle
+    {
+        uint32_t Index = NIL;
+        uint32_t Generation = 0;
+    };
+
+    explicit ZoneDifficultyTimingWheel(uint64_t nowMs = 0) : _currentTick(nowMs / TickMs)
+    {
+        for (auto& level : _slots)
+            level.fill(NIL);
+    }
+
+    /**
+     *  @brief Queue a payload. Due times at or before the current time fire on the next Advance.
+     */
+    Handle Schedule(T const& payload, uint64_t dueMs)
+    {
+        uint32_t index = AllocateNode();
+        Node& node = _nodes[index];
+        node.Payload = payload;
+        node.DueTick = (dueMs + TickMs - 1) / TickMs;
+        Insert(index, _currentTick + 1);
+        ++_size;
+        return { index, node.Generation };
+    }
+
+    /**
+     *  @brief Remove a pending entry. Returns false if it already fired or was cancelled.
+     */
+    bool Cancel(Handle handle)
+    {
+        if (handle.Index >= _nodes.size())
+            return false;
+
+        Node& node = _nodes[handle.Index];
+        if (node.Generation != handle.Generation || node.Bucket == NIL)
+            return false;
+
+        Unlink(handle.Index);
+        FreeNode(handle.Index);
+        --_size;
+        return true;
+    }
+
+    /**
+     *  @brief Move the wheel to nowMs and call fire(payload) for everything that became due,
+     *  tick by tick. fire may schedule new entries.
+     *
+     *  @return The amount of fired entries.
+     */
+    template<class Fire>
+    uint32_t Advance(uint64_t nowMs, Fire&& fire)
+    {
+        uint64_t nowTick = nowMs / TickMs;
+        uint32_t fired = 0;
+
+        while (_currentTick < nowTick)
+        {
+            // Skip empty stretches of the wheel at once
+            if (!_size)
+            {
+                _currentTick = nowTick;
+                break;
+            }
+
+            ++_currentTick;
+            Cascade();
+
+            // Pop one entry at a time, fire may cancel the others of this slot
+            uint32_t& head = _slots[0][_currentTick & (SLOTS - 1)];
+            while (head != NIL)
+            {
+                uint32_t index = head;
+                Unlink(index);
+                T payload = _nodes[index].Payload;
+                FreeNode(index);
+                --_size;
+                ++fired;
+                fire(payload);
+            }
+        }
+
+        return fired;
+    }
+
+    void Clear()
+    {
+        for (auto& level : _slots)
+            level.fill(NIL);
+
+        _overflow = NIL;
+        _freeHead = NIL;
+        _size = 0;
+
+        // Keep the nodes, so handles given out before stay stale instead of matching new entries
+        for (uint32_t index = 0; index < _nodes.size(); ++index)
+        {
+            Node& node = _nodes[index];
+            if (node.Bucket != NIL)
+            {
+                node.Bucket = NIL;
+                ++node.Generation;
+            }
+
+            node.Next = _freeHead;
+            _freeHead = index;
+        }
+    }
+
+    [[nodiscard]] std::size_t Size() const { return _size; }
+    [[nodiscard]] bool Empty() const { return !_size; }
+
+private:
+    struct Node
+    {
+        T Payload{};
+        uint64_t DueTick = 0;
+        uint32_t Next = NIL;
+        uint32_t Prev = NIL;
+        uint32_t Bucket = NIL;      // NIL while the node is free
+        uint32_t Generation = 0;    // bumped whenever the node is freed
+    };
+
+    uint32_t AllocateNode()
+    {
+        if (_freeHead != NIL)
+        {
+            uint32_t index = _freeHead;
+            _freeHead = _nodes[index].Next;
+            return index;
+        }
+
+        _nodes.emplace_back();
+        return uint32_t(_nodes.size() - 1);
+    }
+
+    void FreeNode(uint32_t index)
+    {
+        Node& node = _nodes[index];
+        node.Bucket = NIL;
+        ++node.Generation;
+        node.Next = _freeHead;
+        _freeHead = index;
+    }
+
+    uint32_t& Head(uint32_t bucket)
+    {
+        return bucket == OVERFLOW_BUCKET ? _overflow : _slots[bucket / SLOTS][bucket % SLOTS];
+    }
+
+    void Link(uint32_t index, uint32_t bucket)
+    {
+        Node& node = _nodes[index];
+        uint32_t& head = Head(bucket);
+        node.Bucket = bucket;
+        node.Prev = NIL;
+        node.Next = head;
+        if (head != NIL)
+            _nodes[head].Prev = index;
+        head = index;
+    }
+
+    void Unlink(uint32_t index)
+    {
+        Node& node = _nodes[index];
+        if (node.Prev != NIL)
+            _nodes[node.Prev].Next = node.Next;
+        else
+            Head(node.Bucket) = node.Next;
+
+        if (node.Next != NIL)
+            _nodes[node.Next].Prev = node.Prev;
+
+        node.Prev = NIL;
+        node.Next = NIL;
+    }
+
+    /**
+     *  @brief Link a node into the slot matching its due tick. Nodes due before minTick are treated as due at minTick.
+     */
+    void Insert(uint32_t index, uint64_t minTick)
+    {
+        Node& node = _nodes[index];
+        if (node.DueTick < minTick)
+            node.DueTick = minTick;
+
+        uint64_t delta = node.DueTick - _currentTick;
+        uint32_t bucket = OVERFLOW_BUCKET;
+
+        for (uint32_t level = 0; level < LEVELS; ++level)
+        {
+            if (delta < (uint64_t(1) << (SLOT_BITS * (level + 1))))
+            {
+                bucket = level * SLOTS + ((node.DueTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+                break;
+            }
+        }
+
+        Link(index, bucket);
+    }
+
+    /**
+     *  @brief Pull the entries of higher level slots which are due within the next level down.
+     *  Higher levels first, so their entries can still land in the lower slots cascaded after them.
+     */
+    void Cascade()
+    {
+        if (!(_currentTick & ((uint64_t(1) << (SLOT_BITS * LEVELS)) - 1)))
+            Reinsert(_overflow);
+
+        for (uint32_t level = LEVELS - 1; level > 0; --level)
+        {
+            uint64_t mask = (uint64_t(1) << (SLOT_BITS * level)) - 1;
+            if (_currentTick & mask)
+                continue;
+
+            Reinsert(_slots[level][(_currentTick >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+        }
+    }
+
+    void Reinsert(uint32_t& head)
+    {
+        uint32_t index = head;
+        head = NIL;
+
+        while (index != NIL)
+        {
+            uint32_t next = _nodes[index].Next;
+            Insert(index, _currentTick);
+            index = next;
+        }
+    }
+
+    std::vector<Node> _nodes;
+    uint32_t _freeHead = NIL;
+    std::array<std::array<uint32_t, SLOTS>, LEVELS> _slots;
+    uint32_t _overflow = NIL;
+    uint64_t _currentTick;
+    std::size_t _size = 0;
+};
+
+#endif
@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2016+ AzerothCore <www.azerothcore.org>, released under GNU AGPL v3 license: https://github.com/azerothcore/azerothcore-wotlk/blob/master/LICENSE-AGPL3
+ */
+
+#include "ZoneDifficultyTuningCache.h"
+#include "DatabaseEnv.h"
+#include "Log.h"
+#include "SpellMgr.h"
+#include "Timer.h"
+#include "ZoneDifficulty.h"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <type_traits>
+
+namespace
+{
+    // Tables read by LoadMapDifficultySettings
+    char const* const SourceTables = "zone_difficulty_info, zone_difficulty_spelloverrides, zone_difficulty_disallowed_buffs, "
+        "zone_difficulty_mythicmode_instance_data, pool_quest, zone_difficulty_mythicmode_creatureoverrides, "
+        "zone_difficulty_mythicmode_ai, zone_difficulty_mythicmode_rewards";
+
+    char const CacheMagic[8] = { 'Z', 'D', 'T', 'U', 'N', 'I', 'N', 'G' };
+    std::size_t const SectionAlignment = 64;
+
+    struct CacheHeader
+    {
+        char Magic[8];
+        uint32 Version;
+        uint32 SectionCount;
+        uint64 Checksum;
+        uint64 Size;
+    };
+
+    struct SectionHeader
+    {
+        uint32 Id;
+        uint32 RecordSize;
+        uint64 Count;
+    };
+
+    enum CacheSection : uint32
+    {
+        SECTION_NERF_INFO,
+        SECTION_SPELL_OVERRIDES,
+        SECTION_DISALLOWED_MAPS,
+        SECTION_DISALLOWED_SPELLS,
+        SECTION_MYTHIC_LOOT,
+        SECTION_DAILY_QUESTS,
+        SECTION_CREATURE_OVERRIDES,
+        SECTION_MYTHIC_ABILITIES,
+        SECTION_MYTHIC_PROGRAMS,
+        SECTION_REWARDS,
+
+        SECTION_MAX
+    };
+
+    struct NerfRecord
+    {
+        uint32 MapId;
+        uint32 PhaseMask;
+        ZoneDifficultyNerfData Data;
+    };
+
+    struct SpellOverrideRecord
+    {
+        uint32 SpellId;
+        uint32 MapId;
+        ZoneDifficulySpellOverrideData Data;
+    };
+
+    struct DisallowedMapRecord
+    {
+        uint32 MapId;
+        uint32 SpellCount;
+    };
+
+    struct LootRecord
+    {
+        uint32 MapId;
+        ZoneDifficultyMythicmodeMapData Data;
+    };
+
+    struct CreatureOverrideRecord
+    {
+        uint32 Entry;
+        CreatureOverrideData Data;
+    };
+
+    struct ProgramRecord
+    {
+        uint32 Entry;
+        ZoneDifficultyAbilityProgram Program;
+    };
+
+    struct RewardRecord
+    {
+        uint32 ContentType;
+        uint32 ItemType;
+        bool Tier;
+        ZoneDifficultyRewardData Data;
+    };
+
+    uint64 HashBytes(uint64 hash, void const* data, std::size_t size)
+    {
+        // FNV-1a
+        unsigned char const* bytes = static_cast<unsigned char const*>(data);
+        for (std::size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+
+        return hash;
+    }
+
+    class CacheWriter
+    {
+    public:
+        explicit CacheWriter(std::ofstream& out) : _out(out) { }
+
+        template<typename T>
+        void Write(CacheSection id, std::vector<T> const& records)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            Align();
+            SectionHeader header{ id, uint32(sizeof(T)), records.size() };
+            Put(&header, sizeof(header));
+            Align();
+            Put(records.data(), records.size() * sizeof(T));
+            ++_sections;
+        }
+
+        [[nodiscard]] uint32 GetSectionCount() const { return _sections; }
+        [[nodiscard]] uint64 GetSize() const { return _size; }
+
+    private:
+        void Put(void const* data, std::size_t size)
+        {
+            _out.write(static_cast<char const*>(data), size);
+            _size += size;
+        }
+
+        void Align()
+        {
+            static char const padding[SectionAlignment] = { };
+            if (std::size_t rest = _size % SectionAlignment)
+                Put(padding, SectionAlignment - rest);
+        }
+
+        std::ofstream& _out;
+        uint64 _size = sizeof(CacheHeader);
+        uint32 _sections = 0;
+    };
+
+    // Walks the sections of a mapped file. Records are handed out in place, without copying.
+    class CacheReader
+    {
+    public:
+        CacheReader(char const* data, std::size_t size) : _data(data), _size(size), _offset(sizeof(CacheHeader)) { }
+
+        template<typename T>
+        bool Read(CacheSection id, std::span<T const>& records)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            Align();
+            if (_offset + sizeof(SectionHeader) > _size)
+                return false;
+
+            SectionHeader header;
+            std::memcpy(&header, _data + _offset, sizeof(header));
+            _offset += sizeof(header);
+            Align();
+
+            if (header.Id != id || header.RecordSize != sizeof(T) || header.Count > (_size - _offset) / sizeof(T))
+                return false;
+
+            records = std::span<T const>(reinterpret_cast<T const*>(_data + _offset), header.Count);
+            _offset += header.Count * sizeof(T);
+            return true;
+        }
+
+    private:
+        void Align()
+        {
+            _offset = (_offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+        }
+
+        char const* _data;
+        std::size_t _size;
+        std::size_t _offset;
+    };
+}
+
+/**
+ *  @brief Checksum the source tables with CHECKSUM TABLE, so nothing has to be read row by row
+ *  to find out if the cache is stale. Settings which change what is loaded are mixed in.
+ */
+std::optional<uint64> ZoneDifficultyTuningCache::Checksum()
+{
+    QueryResult result = WorldDatabase.Query("CHECKSUM TABLE {}", SourceTables);
+    if (!result)
+    {
+        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Could not checksum the tuning tables, the tuning cache is not used.");
+        return std::nullopt;
+    }
+
+    uint64 hash = 0xCBF29CE484222325ULL;
+    hash = HashBytes(hash, &VERSION, sizeof(VERSION));
+    hash = HashBytes(hash, &sZoneDifficulty->MythicmodeEnable, sizeof(sZoneDifficulty->MythicmodeEnable));
+
+    do
+    {
+        std::string table = (*result)[0].Get<std::string>();
+        // NULL for a table which does not exist or could not be read
+        if ((*result)[1].IsNull())
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Could not checksum {}, the tuning cache is not used.", table);
+            return std::nullopt;
+        }
+
+        uint64 checksum = (*result)[1].Get<uint64>();
+        hash = HashBytes(hash, table.data(), table.size());
+        hash = HashBytes(hash, &checksum, sizeof(checksum));
+    } while (result->NextRow());
+
+    return hash;
+}
+
+bool ZoneDifficultyTuningCache::Load(std::string const& path, uint64 checksum, ZoneDifficultySnapshot& snapshot)
+{
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error))
+        return false;
+
+    boost::interprocess::mapped_region region;
+    try
+    {
+        boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+        region = boost::interprocess::mapped_region(file, boost::interprocess::read_only);
+    }
+    catch (boost::interprocess::interprocess_exception const& e)
+    {
+        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Could not map the tuning cache {}: {}", path, e.what());
+        return false;
+    }
+
+    char const* data = static_cast<char const*>(region.get_address());
+    std::size_t size = region.get_size();
+
+    CacheHeader header;
+    if (size < sizeof(header))
+        return false;
+
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.Magic, CacheMagic, sizeof(CacheMagic)) || header.Version != VERSION || header.Checksum != checksum
+        || header.Size != size || header.SectionCount != SECTION_MAX)
+        return false;
+
+    CacheReader reader(data, size);
+    std::span<NerfRecord const> nerfs;
+    std::span<SpellOverrideRecord const> spellOverrides;
+    std::span<DisallowedMapRecord const> disallowedMaps;
+    std::span<uint32 const> disallowedSpells;
+    std::span<LootRecord const> loot;
+    std::span<uint32 const> dailyQuests;
+    std::span<CreatureOverrideRecord const> creatureOverrides;
+    std::span<ZoneDifficultyHAI const> abilities;
+    std::span<ProgramRecord const> programs;
+    std::span<RewardRecord const> rewards;
+
+    if (!reader.Read(SECTION_NERF_INFO, nerfs) || !reader.Read(SECTION_SPELL_OVERRIDES, spellOverrides)
+        || !reader.Read(SECTION_DISALLOWED_MAPS, disallowedMaps) || !reader.Read(SECTION_DISALLOWED_SPELLS, disallowedSpells)
+        || !reader.Read(SECTION_MYTHIC_LOOT, loot) || !reader.Read(SECTION_DAILY_QUESTS, dailyQuests)
+        || !reader.Read(SECTION_CREATURE_OVERRIDES, creatureOverrides) || !reader.Read(SECTION_MYTHIC_ABILITIES, abilities)
+        || !reader.Read(SECTION_MYTHIC_PROGRAMS, programs) || !reader.Read(SECTION_REWARDS, rewards))
+    {
+        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: The tuning cache {} is damaged, loading from the database.", path);
+        return false;
+    }
+
+    // Spells are the one thing the checksum does not cover, the spell store may have changed.
+    // Everything is checked before the snapshot is touched, so the database can still fill it.
+    for (ZoneDifficultyHAI const& ability : abilities)
+        if (!sSpellMgr->GetSpellInfo(ability.SpellId))
+            return false;
+
+    for (ProgramRecord const& record : programs)
+        if (record.Program.First > abilities.size() || record.Program.Count > abilities.size() - record.Program.First)
+            return false;
+
+    std::size_t disallowedSpellCount = 0;
+    for (DisallowedMapRecord const& record : disallowedMaps)
+        disallowedSpellCount += record.SpellCount;
+
+    if (disallowedSpellCount != disallowedSpells.size())
+        return false;
+
+    snapshot.MythicmodeAbilities.assign(abilities.begin(), abilities.end());
+    for (ZoneDifficultyHAI& ability : snapshot.MythicmodeAbilities)
+        ability.Spell = sSpellMgr->GetSpellInfo(ability.SpellId);
+
+    for (ProgramRecord const& record : programs)
+        snapshot.MythicmodeAI[record.Entry] = record.Program;
+
+    for (NerfRecord const& record : nerfs)
+        snapshot.NerfInfo[record.MapId][record.PhaseMask] = record.Data;
+
+    for (SpellOverrideRecord const& record : spellOverrides)
+        snapshot.SpellNerfOverrides[record.SpellId][record.MapId] = record.Data;
+
+    std::size_t spellOffset = 0;
+    for (DisallowedMapRecord const& record : disallowedMaps)
+    {
+        std::span<uint32 const> spells = disallowedSpells.subspan(spellOffset, record.SpellCount);
+        snapshot.DisallowedBuffs[record.MapId].assign(spells.begin(), spells.end());
+        spellOffset += record.SpellCount;
+    }
+
+    for (LootRecord const& record : loot)
+    {
+        snapshot.MythicmodeLoot[record.MapId].push_back(record.Data);
+        snapshot.Expansion[record.MapId] = record.Data.RewardType;
+    }
+
+    snapshot.DailyHeroicQuests.assign(dailyQuests.begin(), dailyQuests.end());
+
+    for (CreatureOverrideRecord const& record : creatureOverrides)
+        snapshot.CreatureOverrides[record.Entry] = record.Data;
+
+    for (RewardRecord const& record : rewards)
+    {
+        if (record.Tier)
+            snapshot.TierRewards[record.ContentType] = record.Data;
+        else
+            snapshot.Rewards[record.ContentType][record.ItemType].push_back(record.Data);
+    }
+
+    snapshot.BuildNerfTable();
+    snapshot.SpellOverrideIndex.Build(snapshot.SpellNerfOverrides);
+    return true;
+}
+
+/**
+ *  @brief Write the table data of a freshly loaded snapshot. The file is written next to
+ *  the target and renamed over it, a crash while saving never leaves a half written cache.
+ */
+void ZoneDifficultyTuningCache::Save(std::string const& path, uint64 checksum, ZoneDifficultySnapshot const& snapshot)
+{
+    uint32 oldMSTime = getMSTime();
+
+    std::vector<NerfRecord> nerfs;
+    for (auto const& [mapId, phases] : snapshot.NerfInfo)
+        for (auto const& [phaseMask, data] : phases)
+            nerfs.push_back({ mapId, phaseMask, data });
+
+    std::vector<SpellOverrideRecord> spellOverrides;
+    for (auto const& [spellId, maps] : snapshot.SpellNerfOverrides)
+        for (auto const& [mapId, data] : maps)
+            spellOverrides.push_back({ spellId, mapId, data });
+
+    std::vector<DisallowedMapRecord> disallowedMaps;
+    std::vector<uint32> disallowedSpells;
+    for (auto const& [mapId, spells] : snapshot.DisallowedBuffs)
+    {
+        disallowedMaps.push_back({ mapId, uint32(spells.size()) });
+        disallowedSpells.insert(disallowedSpells.end(), spells.begin(), spells.end());
+    }
+
+    std::vector<LootRecord> loot;
+    for (auto const& [mapId, encounters] : snapshot.MythicmodeLoot)
+        for (ZoneDifficultyMythicmodeMapData const& data : encounters)
+            loot.push_back({ mapId, data });
+
+    std::vector<CreatureOverrideRecord> creatureOverrides;
+    for (auto const& [entry, data] : snapshot.CreatureOverrides)
+        creatureOverrides.push_back({ entry, data });
+
+    std::vector<ProgramRecord> programs;
+    for (auto const& [entry, program] : snapshot.MythicmodeAI)
+        programs.push_back({ entry, program });
+
+    std::vector<RewardRecord> rewards;
+    for (auto const& [contentType, itemTypes] : snapshot.Rewards)
+        for (auto const& [itemType, items] : itemTypes)
+            for (ZoneDifficultyRewardData const& data : items)
+                rewards.push_back({ contentType, itemType, false, data });
+    for (auto const& [contentType, data] : snapshot.TierRewards)
+        rewards.push_back({ contentType, 0, true, data });
+
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Could not write the tuning cache {}.", tempPath);
+        return;
+    }
+
+    // The header is written last, once the size is known
+    CacheHeader header{ };
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    CacheWriter writer(out);
+    writer.Write(SECTION_NERF_INFO, nerfs);
+    writer.Write(SECTION_SPELL_OVERRIDES, spellOverrides);
+    writer.Write(SECTION_DISALLOWED_MAPS, disallowedMaps);
+    writer.Write(SECTION_DISALLOWED_SPELLS, disallowedSpells);
+    writer.Write(SECTION_MYTHIC_LOOT, loot);
+    writer.Write(SECTION_DAILY_QUESTS, snapshot.DailyHeroicQuests);
+    writer.Write(SECTION_CREATURE_OVERRIDES, creatureOverrides);
+    writer.Write(SECTION_MYTHIC_ABILITIES, snapshot.MythicmodeAbilities);
+    writer.Write(SECTION_MYTHIC_PROGRAMS, programs);
+    writer.Write(SECTION_REWARDS, rewards);
+
+    std::memcpy(header.Magic, CacheMagic, sizeof(CacheMagic));
+    header.Version = VERSION;
+    header.SectionCount = writer.GetSectionCount();
+    header.Checksum = checksum;
+    header.Size = writer.GetSize();
+    out.seekp(0);
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    out.close();
+
+    std::error_code error;
+    if (out)
+        std::filesystem::rename(tempPath, path, error);
+
+    if (!out || error)
+    {
+        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Could not write the tuning cache {}.", path);
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Wrote the tuning cache {} ({} bytes) in {} ms.", path, header.Size, GetMSTimeDiffToNow(oldMSTime));
+}
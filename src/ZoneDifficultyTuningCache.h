@@ -0,0 +1,31 @@
+#ifndef DEF_ZONEDIFFICULTY_TUNINGCACHE_H
+#define DEF_ZONEDIFFICULTY_TUNINGCACHE_H
+
+#include "Define.h"
+#include <optional>
+#include <string>
+
+struct ZoneDifficultySnapshot;
+
+/**
+ *  @brief Binary copy of the tuning data loaded from the zone_difficulty_* world tables.
+ *
+ *  The file stores the parsed tables as flat record arrays together with a checksum of the
+ *  source tables. On load the file is memory mapped and the arrays are copied straight into
+ *  the snapshot, as long as the checksum still matches the tables in the database.
+ */
+class ZoneDifficultyTuningCache
+{
+public:
+    // Bump whenever the layout of the file or of a cached record changes
+    static constexpr uint32 VERSION = 1;
+
+    // Checksum over the source tables and the config which changes what is loaded from them,
+    // nullopt if a table could not be checksummed and the cache must not be used
+    [[nodiscard]] static std::optional<uint64> Checksum();
+    // Fill the table data of the snapshot from the file, false if it is missing or stale
+    [[nodiscard]] static bool Load(std::string const& path, uint64 checksum, ZoneDifficultySnapshot& snapshot);
+    static void Save(std::string const& path, uint64 checksum, ZoneDifficultySnapshot const& snapshot);
+};
+
+#endif
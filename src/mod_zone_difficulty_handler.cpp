@@ -7,6 +7,7 @@
 #include "GameTime.h"
 #include "ItemTemplate.h"
 #include "MapMgr.h"
+#include "ObjectMgr.h"
 #include "Pet.h"
 #include "Player.h"
 #include "PoolMgr.h"
@@ -14,11 +15,21 @@
 #include "ScriptMgr.h"
 #include "SpellAuras.h"
 #include "SpellAuraEffects.h"
+#include "SpellMgr.h"
 #include "StringConvert.h"
 #include "TaskScheduler.h"
+#include "Timer.h"
 #include "Tokenize.h"
+#include "TypeContainerVisitor.h"
 #include "Unit.h"
 #include "ZoneDifficulty.h"
+#include "ZoneDifficultyTargetSnapshot.h"
+#include "ZoneDifficultyTuningCache.h"
+#include <algorithm>
+#include <bit>
+#include <future>
+#include <limits>
+#include <set>
 
 ZoneDifficulty* ZoneDifficulty::instance()
 {
@@ -26,418 +37,1142 @@ ZoneDifficulty* ZoneDifficulty::instance()
     return &instance;
 }
 
-void ZoneDifficulty::LoadMapDifficultySettings()
+namespace
 {
-    if (!sZoneDifficulty->IsEnabled)
-        return;
+    // Snapshot pinned by the current thread, refreshed once per map update
+    thread_local std::shared_ptr<ZoneDifficultySnapshot const> PinnedSnapshot;
 
-    sZoneDifficulty->Rewards.clear();
-    sZoneDifficulty->MythicmodeAI.clear();
-    sZoneDifficulty->CreatureOverrides.clear();
-    sZoneDifficulty->DailyHeroicQuests.clear();
-    sZoneDifficulty->MythicmodeLoot.clear();
-    sZoneDifficulty->DisallowedBuffs.clear();
-    sZoneDifficulty->SpellNerfOverrides.clear();
-    sZoneDifficulty->NerfInfo.clear();
+    // Remembers what a creature's health was last scaled for, so repeated events are no-ops
+    class ZoneDifficultyScaleMarker : public DataMap::Base
+    {
+    public:
+        uint32 Version = std::numeric_limits<uint32>::max();
+        uint32 PhaseMask = 0;
+        bool IsMythic = false;
+    };
 
-    // Default values for when there is no entry in the db for duels (index 0xFFFFFFFF)
-    NerfInfo[DUEL_INDEX][0].HealingNerfPct = 1;
-    NerfInfo[DUEL_INDEX][0].AbsorbNerfPct = 1;
-    NerfInfo[DUEL_INDEX][0].MeleeDamageBuffPct = 1;
-    NerfInfo[DUEL_INDEX][0].SpellDamageBuffPct = 1;
-    NerfInfo[DUEL_INDEX][0].HealingNerfPctHard = 1;
-    NerfInfo[DUEL_INDEX][0].AbsorbNerfPctHard = 1;
-    NerfInfo[DUEL_INDEX][0].MeleeDamageBuffPctHard = 1;
-    NerfInfo[DUEL_INDEX][0].SpellDamageBuffPctHard = 1;
+    std::string const ScaleMarkerKey = "ZoneDifficultyScale";
 
-    // Heroic Quest -> MapId Translation
-    HeroicTBCQuestMapList[542] = 11362; // Blood Furnace
-    HeroicTBCQuestMapList[543] = 11354; // Hellfire Ramparts
-    HeroicTBCQuestMapList[547] = 11368; // Slave Pens
-    HeroicTBCQuestMapList[546] = 11369; // The Underbog
-    HeroicTBCQuestMapList[557] = 11373; // Mana-Tombs
-    HeroicTBCQuestMapList[558] = 11374; // Auchenai Crypts
-    HeroicTBCQuestMapList[560] = 11378; // The Escape From Durnholde
-    HeroicTBCQuestMapList[556] = 11372; // Sethekk Halls
-    HeroicTBCQuestMapList[585] = 11499; // Magisters' Terrace
-    HeroicTBCQuestMapList[555] = 11375; // Shadow Labyrinth
-    HeroicTBCQuestMapList[540] = 11363; // Shattered Halls
-    HeroicTBCQuestMapList[552] = 11388; // The Arcatraz
-    HeroicTBCQuestMapList[269] = 11382; // The Black Morass
-    HeroicTBCQuestMapList[553] = 11384; // The Botanica
-    HeroicTBCQuestMapList[554] = 11386; // The Mechanar
-    HeroicTBCQuestMapList[545] = 11370; // The Steamvault
+    // Visits the creatures of a map's object store, which unlike the spawn id store also holds summons
+    struct CreatureRescaler
+    {
+        uint32 Count = 0;
 
-    // Category 8
-    EncounterCounter[542] = 3; // Blood Furnace
-    EncounterCounter[543] = 3; // Hellfire Ramparts
-    EncounterCounter[547] = 3; // Slave Pens
-    EncounterCounter[546] = 4; // The Underbog
-    EncounterCounter[557] = 4; // Mana-Tombs
-    EncounterCounter[558] = 2; // Auchenai Crypts
-    EncounterCounter[560] = 3; // The Escape From Durnholde
-    EncounterCounter[556] = 3; // Sethekk Halls
-    //EncounterCounter[585] = 4; // Magisters' Terrace
-    EncounterCounter[555] = 4; // Shadow Labyrinth
-    EncounterCounter[540] = 4; // Shattered Halls
-    EncounterCounter[552] = 4; // The Arcatraz
-    EncounterCounter[269] = 3; // The Black Morass
-    EncounterCounter[553] = 5; // The Botanica
-    EncounterCounter[554] = 3; // The Mechanar
-    EncounterCounter[545] = 3; // The Steamvault
+        void Visit(std::unordered_map<ObjectGuid, Creature*>& creatures)
+        {
+            for (auto const& pair : creatures)
+                if (sZoneDifficulty->ScaleCreatureHealth(pair.second, false))
+                    ++Count;
+        }
 
-    // Category 9
-    EncounterCounter[565] = 2; // Gruul's Lair
-    EncounterCounter[544] = 1; // Magtheridon's Lair
-    EncounterCounter[532] = 12; // Karazhan
+        template<class T>
+        void Visit(std::unordered_map<ObjectGuid, T*>&) { }
+    };
+    std::string const ScoreLedgerKey = "ZoneDifficultyScore";
 
-    // Category 10
-    EncounterCounter[548] = 7; // Serpentshrine Cavern
+    // Scaled base health by (entry, level, unit class, mode), valid for one snapshot and config generation
+    struct ScaledHealthCache
+    {
+        uint32 SnapshotVersion = std::numeric_limits<uint32>::max();
+        uint32 ConfigGeneration = std::numeric_limits<uint32>::max();
+        std::unordered_map<uint64, ZoneDifficultyScaledHealth> Entries;
+    };
 
-    // Category 11
-    EncounterCounter[564] = 9; // Black Temple
+    thread_local ScaledHealthCache HealthCache;
 
-    // Category 12
-    EncounterCounter[568] = 6; // Zul'Aman
+    // The abilities of a unit waiting in the ability wheel, one handle per MythicmodeAI row
+    class ZoneDifficultyAbilityMarker : public DataMap::Base
+    {
+    public:
+        uint32 Generation = 0;  // bumped on cancel, together with the GUID it identifies the unit
+        std::vector<ZoneDifficultyAbilityWheel::Handle> Slots;
+        std::vector<ZoneDifficultyMythicAbility> Parked;   // due while the unit was casting
+    };
 
-    // Category 18
-    EncounterCounter[534] = 5; // Hyjal Summit
+    uint8 GetMythicAbilityPriority(uint32 entry, uint32 index)
+    {
+        ZoneDifficultyHAI const* ability = sZoneDifficulty->GetSnapshot().GetMythicAbility(entry, index);
+        return ability ? ability->Priority : 0;
+    }
 
-    // Icons
-    sZoneDifficulty->ItemIcons[ITEMTYPE_MISC] = "|TInterface\\icons\\inv_misc_cape_17:15|t |TInterface\\icons\\inv_misc_gem_topaz_02:15|t |TInterface\\icons\\inv_jewelry_ring_51naxxramas:15|t ";
-    sZoneDifficulty->ItemIcons[ITEMTYPE_CLOTH] = "|TInterface\\icons\\inv_chest_cloth_42:15|t ";
-    sZoneDifficulty->ItemIcons[ITEMTYPE_LEATHER] = "|TInterface\\icons\\inv_helmet_41:15|t ";
-    sZoneDifficulty->ItemIcons[ITEMTYPE_MAIL] = "|TInterface\\icons\\inv_chest_chain_13:15|t ";
-    sZoneDifficulty->ItemIcons[ITEMTYPE_PLATE] = "|TInterface\\icons\\inv_chest_plate12:15|t ";
-    sZoneDifficulty->ItemIcons[ITEMTYPE_WEAPONS] = "|TInterface\\icons\\inv_mace_25:15|t |TInterface\\icons\\inv_shield_27:15|t |TInterface\\icons\\inv_weapon_crossbow_04:15|t ";
+    std::string const AbilityMarkerKey = "ZoneDifficultyAbilities";
 
-    if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_info WHERE Enabled > 0"))
+    uint32 const MAX_THREAT_TARGETS = 128;
+
+    // Threat list positions of the unit whose abilities are firing, taken once per unit and map update
+    struct ThreatTargetCache
     {
-        do
+        ObjectGuid Owner;
+        uint64 UpdateSerial = 0;
+        ZoneDifficultyTargetSnapshot<Unit*, MAX_THREAT_TARGETS> Targets;
+        std::vector<Unit*> Overflow;    // threat list entries past MAX_THREAT_TARGETS, checked one by one
+        ZoneDifficultyCandidateSet<MAX_THREAT_TARGETS> Candidates;
+        // Players of Targets within GridRange, bucketed by GridCellSize
+        ZoneDifficultyTargetGrid<MAX_THREAT_TARGETS> Grid;
+        bool GridValid = false;
+        float GridRange = 0.0f;
+        float GridCellSize = 0.0f;
+    };
+
+    thread_local uint64 MythicUpdateSerial = 0;    // bumped by every UpdateMythicAbilities on this thread
+    thread_local ThreatTargetCache ThreatTargets;
+
+    ThreatTargetCache& GatherThreatTargets(Unit* unit)
+    {
+        if (ThreatTargets.Owner == unit->GetGUID() && ThreatTargets.UpdateSerial == MythicUpdateSerial)
+            return ThreatTargets;
+
+        ThreatTargets.Owner = unit->GetGUID();
+        ThreatTargets.UpdateSerial = MythicUpdateSerial;
+        ThreatTargets.Targets.Clear();
+        ThreatTargets.Overflow.clear();
+        ThreatTargets.GridValid = false;
+
+        for (HostileReference* reference : unit->GetThreatMgr().GetThreatList())
         {
-            uint32 mapId = (*result)[0].Get<uint32>();
-            uint32 phaseMask = (*result)[1].Get<uint32>();
-            ZoneDifficultyNerfData data;
-            int8 mode = (*result)[6].Get<int8>();
+            Unit* target = reference->getTarget();
+            if (!target)
+                continue;
 
-            if (sZoneDifficulty->HasNormalMode(mode))
-            {
-                data.HealingNerfPct = (*result)[2].Get<float>();
-                data.AbsorbNerfPct = (*result)[3].Get<float>();
-                data.MeleeDamageBuffPct = (*result)[4].Get<float>();
-                data.SpellDamageBuffPct = (*result)[5].Get<float>();
-                data.Enabled = data.Enabled | mode;
-                sZoneDifficulty->NerfInfo[mapId][phaseMask] = data;
-            }
-            if (sZoneDifficulty->HasMythicmode(mode) && sZoneDifficulty->MythicmodeEnable)
-            {
-                data.HealingNerfPctHard = (*result)[2].Get<float>();
-                data.AbsorbNerfPctHard = (*result)[3].Get<float>();
-                data.MeleeDamageBuffPctHard = (*result)[4].Get<float>();
-                data.SpellDamageBuffPctHard = (*result)[5].Get<float>();
-                data.Enabled = data.Enabled | mode;
-                sZoneDifficulty->NerfInfo[mapId][phaseMask] = data;
-            }
-            if ((mode & MODE_HARD) != MODE_HARD && (mode & MODE_NORMAL) != MODE_NORMAL)
-            {
-                LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Invalid mode {} used in Enabled for mapId {}, ignored.", mode, mapId);
-            }
+            if (!ThreatTargets.Targets.Add(target, target->GetPositionX(), target->GetPositionY(), target->GetPositionZ(), target->GetObjectSize()))
+                ThreatTargets.Overflow.push_back(target);
+        }
 
-            // duels do not check for phases. Only 0 is allowed.
-            if (mapId == DUEL_INDEX && phaseMask != 0)
-            {
-                LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Table `zone_difficulty_info` for criteria (duel mapId: {}) has wrong value ({}), must be 0 for duels.", mapId, phaseMask);
-            }
+        return ThreatTargets;
+    }
 
-        } while (result->NextRow());
+    /**
+     *  @brief Pick the target of the cluster target types from the players on the threat list.
+     *  Players beyond the first MAX_THREAT_TARGETS threat list entries are not considered.
+     */
+    Unit* SelectClusterTarget(Unit* unit, ZoneDifficultyHAI const& mythicAI)
+    {
+        ThreatTargetCache& threat = GatherThreatTargets(unit);
+
+        // Abilities of the unit with the same range and radius share the grid within an update
+        if (!threat.GridValid || threat.GridRange != mythicAI.SelectRange || threat.GridCellSize != mythicAI.Radius)
+        {
+            threat.Targets.FilterWithin(unit->GetPositionX(), unit->GetPositionY(), unit->GetPositionZ(), mythicAI.SelectRange + unit->GetObjectSize(), threat.Candidates);
+
+            uint32 players = 0;
+            for (uint16 index : threat.Candidates)
+                if (threat.Targets[index]->IsPlayer())
+                    threat.Candidates.Indices[players++] = index;
+
+            threat.Candidates.Count = players;
+            threat.Grid.Build(threat.Targets, threat.Candidates, mythicAI.Radius);
+            threat.GridValid = true;
+            threat.GridRange = mythicAI.SelectRange;
+            threat.GridCellSize = mythicAI.Radius;
+        }
+
+        uint32 index = mythicAI.Target == TARGET_PLAYER_DENSEST_CLUSTER ? threat.Grid.DensestCluster() : threat.Grid.MostNeighbors(mythicAI.Radius);
+        return index != threat.Grid.NONE ? threat.Targets[index] : nullptr;
     }
 
-    if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_spelloverrides"))
+    void CastMythicAbility(Unit* unit, Unit* target, ZoneDifficultyHAI const& mythicAI)
     {
-        do
+        if (!(mythicAI.Flags & MYTHIC_ABILITY_BP_MASK))
         {
-            if ((*result)[3].Get<uint8>() > 0)
-            {
-                sZoneDifficulty->SpellNerfOverrides[(*result)[0].Get<uint32>()][(*result)[1].Get<uint32>()].NerfPct = (*result)[2].Get<float>();
-                sZoneDifficulty->SpellNerfOverrides[(*result)[0].Get<uint32>()][(*result)[1].Get<uint32>()].ModeMask = (*result)[3].Get<uint32>();
-            }
+            unit->CastSpell(target, mythicAI.Spell, mythicAI.TriggerFlags);
+            return;
+        }
 
-        } while (result->NextRow());
+        unit->CastCustomSpell(target, mythicAI.SpellId,
+            (mythicAI.Flags & MYTHIC_ABILITY_FLAG_BP0) ? &mythicAI.BasePoints[0] : nullptr,
+            (mythicAI.Flags & MYTHIC_ABILITY_FLAG_BP1) ? &mythicAI.BasePoints[1] : nullptr,
+            (mythicAI.Flags & MYTHIC_ABILITY_FLAG_BP2) ? &mythicAI.BasePoints[2] : nullptr,
+            mythicAI.Flags & MYTHIC_ABILITY_FLAG_TRIGGERED);
     }
 
-    if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_disallowed_buffs"))
+    // A row of zone_difficulty_mythicmode_ai as stored in the database
+    struct MythicAbilityRow
     {
-        do
+        uint8 Chance = 0;
+        uint32 Spell = 0;
+        int32 Spellbp[3] = { 0, 0, 0 };
+        uint8 Target = 0;
+        int8 TargetArg = 0;
+        uint8 TargetArg2 = 0;
+        Milliseconds Delay{ 0 };
+        Milliseconds Cooldown{ 0 };
+        uint8 Repetitions = 0;
+        bool TriggeredCast = false;
+        uint8 Priority = 0;
+    };
+
+    /**
+     *  @brief Validate a zone_difficulty_mythicmode_ai row and resolve everything MythicmodeEvent needs.
+     *
+     *  @return false if the row can not be used. The reason is logged.
+     */
+    bool CompileMythicAbility(uint32 entry, MythicAbilityRow const& row, ZoneDifficultyHAI& ability)
+    {
+        if (!sObjectMgr->GetCreatureTemplate(entry))
         {
-            std::vector<uint32> debuffs;
-            uint32 mapId = 0;
-            if ((*result)[2].Get<bool>())
-            {
-                std::string spellString = (*result)[1].Get<std::string>();
-                std::vector<std::string_view> tokens = Acore::Tokenize(spellString, ' ', false);
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} does not exist, Spell {} skipped.", entry, row.Spell);
+            return false;
+        }
+
+        if (!row.Chance || row.Chance > 100)
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} Spell {} has `Chance` {} outside of 1-100, skipped.", entry, row.Spell, row.Chance);
+            return false;
+        }
 
-                mapId = (*result)[0].Get<uint32>();
-                for (auto token : tokens)
+        SpellInfo const* spellInfo = sSpellMgr->GetSpellInfo(row.Spell);
+        if (!spellInfo)
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} uses `Spell` {} which does not exist, skipped.", entry, row.Spell);
+            return false;
+        }
+
+        ability.Spell = spellInfo;
+        ability.SpellId = row.Spell;
+        ability.Chance = row.Chance;
+        ability.Target = row.Target;
+        ability.Priority = row.Priority;
+        ability.Delay = row.Delay;
+        ability.Cooldown = row.Cooldown;
+
+        switch (row.Target)
+        {
+            case TARGET_NONE:
+            case TARGET_SELF:
+            case TARGET_VICTIM:
+                break;
+            case TARGET_HOSTILE_AGGRO_FROM_TOP:
+                ability.SelectRange = row.TargetArg > 0 ? row.TargetArg : 200.0f;
+                ability.ThreatPosition = row.TargetArg2;
+                break;
+            case TARGET_HOSTILE_AGGRO_FROM_BOTTOM:
+                if (row.TargetArg < 0)
                 {
-                    if (token.empty())
-                        continue;
+                    LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} Spell {} has a negative threat position in `TargetArg`: {}, skipped.", entry, row.Spell, row.TargetArg);
+                    return false;
+                }
 
-                    uint32 spell = 0;
-                    if ((spell = Acore::StringTo<uint32>(token).value()))
-                        debuffs.push_back(spell);
-                    else
-                        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Disabling buffs for spell '{}' is invalid, skipped.", spell);
+                ability.SelectRange = row.TargetArg2 > 0 ? row.TargetArg2 : 200.0f;
+                ability.ThreatPosition = row.TargetArg;
+                break;
+            case TARGET_HOSTILE_RANDOM:
+            case TARGET_HOSTILE_RANDOM_NOT_TOP:
+                ability.SelectRange = row.TargetArg;
+                break;
+            case TARGET_PLAYER_DENSEST_CLUSTER:
+            case TARGET_PLAYER_MOST_ALLIES:
+                if (!row.TargetArg2)
+                {
+                    LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} Spell {} needs a cluster radius above 0 in `TargetArg2` for `Target` {}, skipped.", entry, row.Spell, row.Target);
+                    return false;
+                }
+
+                ability.SelectRange = row.TargetArg > 0 ? row.TargetArg : 200.0f;
+                ability.Radius = row.TargetArg2;
+                break;
+            case TARGET_PLAYER_DISTANCE:
+                // 0 is accepted, it limits the ability to players in melee contact
+                if (row.TargetArg < 0)
+                {
+                    LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} Spell {} has a negative distance in `TargetArg` for `Target` {}, skipped.", entry, row.Spell, row.Target);
+                    return false;
                 }
-                sZoneDifficulty->DisallowedBuffs[mapId] = debuffs;
+
+                ability.SelectRange = row.TargetArg;
+                break;
+            default:
+                LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} Spell {} has an unknown type for `Target`: {}, skipped.", entry, row.Spell, row.Target);
+                return false;
+        }
+
+        if (!row.Repetitions)
+        {
+            if (row.Cooldown <= Milliseconds::zero())
+            {
+                LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} Spell {} repeats without a `Cooldown`, skipped.", entry, row.Spell);
+                return false;
             }
-        } while (result->NextRow());
-    }
 
-    if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_mythicmode_instance_data"))
-    {
-        do
+            ability.Flags |= MYTHIC_ABILITY_FLAG_REPEAT;
+        }
+
+        for (uint8 i = 0; i < MAX_SPELL_EFFECTS; ++i)
         {
-            ZoneDifficultyMythicmodeMapData data;
-            uint32 MapID = (*result)[0].Get<uint32>();
-            data.EncounterEntry = (*result)[1].Get<uint32>();
-            data.Override = (*result)[2].Get<uint32>();
-            data.RewardType = (*result)[3].Get<uint8>();
+            if (!row.Spellbp[i])
+                continue;
 
-            sZoneDifficulty->MythicmodeLoot[MapID].push_back(data);
-            //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New creature for map {} with entry: {}", MapID, data.EncounterEntry);
+            if (!spellInfo->Effects[i].IsEffect())
+            {
+                LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: zone_difficulty_mythicmode_ai: CreatureEntry {} Spell {} sets `Spellbp{}` but the spell has no effect {}, ignored.", entry, row.Spell, i, i);
+                continue;
+            }
 
-            Expansion[MapID] = data.RewardType;
+            ability.BasePoints[i] = row.Spellbp[i];
+            ability.Flags |= MYTHIC_ABILITY_FLAG_BP0 << i;
+        }
 
-        } while (result->NextRow());
-    }
-    else
-    {
-        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT * FROM zone_difficulty_mythicmode_instance_data");
+        if (row.TriggeredCast)
+        {
+            ability.Flags |= MYTHIC_ABILITY_FLAG_TRIGGERED;
+            ability.TriggerFlags = TRIGGERED_FULL_MASK;
+        }
+
+        // Targets which can come up empty fall back to the victim, as long as it is within TargetArg (outside of it, if negative)
+        if (row.Target != TARGET_NONE && row.TargetArg)
+        {
+            ability.Flags |= MYTHIC_ABILITY_FLAG_FALLBACK;
+            ability.MinRange = row.TargetArg > 0 ? 0.0f : -row.TargetArg;
+            ability.MaxRange = row.TargetArg > 0 ? row.TargetArg : MAX_VISIBILITY_DISTANCE;
+        }
+
+        return true;
     }
 
-    if (QueryResult result = WorldDatabase.Query("SELECT entry FROM `pool_quest` WHERE `pool_entry`=356"))
+    // Time one table took to query and parse, logged once all tables of a load are in
+    struct TableLoadTime
     {
-        do
+        char const* Table;
+        uint64 Rows;
+        uint32 Ms;
+    };
+
+    // Query and parse a table on its own thread. The loader returns the number of rows read.
+    template<typename Loader>
+    std::future<TableLoadTime> LoadTableAsync(char const* table, Loader loader)
+    {
+        return std::async(std::launch::async, [table, loader = std::move(loader)]()
         {
-            sZoneDifficulty->DailyHeroicQuests.push_back((*result)[0].Get<uint32>());
-            //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Adding daily heroic quest with id {}.", (*result)[0].Get<uint32>());
-        } while (result->NextRow());
+            uint32 oldMSTime = getMSTime();
+            uint64 rows = loader();
+            return TableLoadTime{ table, rows, GetMSTimeDiffToNow(oldMSTime) };
+        });
     }
-    else
+
+    void WaitForTableLoads(std::vector<std::future<TableLoadTime> >& loads, char const* database, uint32 oldMSTime)
     {
-        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT entry FROM `pool_quest` WHERE `pool_entry`=356");
+        std::vector<TableLoadTime> times;
+        for (std::future<TableLoadTime>& load : loads)
+            times.push_back(load.get());
+
+        std::sort(times.begin(), times.end(), [](TableLoadTime const& a, TableLoadTime const& b) { return a.Ms > b.Ms; });
+
+        LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loaded {} {} tables in {} ms.", times.size(), database, GetMSTimeDiffToNow(oldMSTime));
+        for (TableLoadTime const& time : times)
+            LOG_INFO("module", "MOD-ZONE-DIFFICULTY:     {} ms for {} rows of {}", time.Ms, time.Rows, time.Table);
     }
 
-    if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_mythicmode_creatureoverrides"))
+    struct TierMap
     {
-        do
-        {
-            uint32 creatureEntry = (*result)[0].Get<uint32>();
-            float hpModifier = (*result)[1].Get<float>();
-            float hpModifierNormal = (*result)[2].Get<float>();
-            bool enabled = (*result)[3].Get<bool>();
+        uint8 Category;
+        uint32 MapId;
+    };
 
-            if (enabled)
-            {
-                CreatureOverrideData data;
-                if (hpModifier)
-                    data.MythicOverride = hpModifier;
+    // The maps of the tiers checked by HasCompletedFullTier. The position of a map is its progress slot.
+    constexpr std::array<TierMap, MYTHIC_PROGRESS_SLOTS> TierMaps =
+    { {
+        //585 is Magister's Terrace. Only add when released.
+        { TYPE_HEROIC_TBC, 269 }, { TYPE_HEROIC_TBC, 540 }, { TYPE_HEROIC_TBC, 542 }, { TYPE_HEROIC_TBC, 543 }, { TYPE_HEROIC_TBC, 545 },
+        { TYPE_HEROIC_TBC, 547 }, { TYPE_HEROIC_TBC, 546 }, { TYPE_HEROIC_TBC, 552 }, { TYPE_HEROIC_TBC, 553 }, { TYPE_HEROIC_TBC, 554 },
+        { TYPE_HEROIC_TBC, 555 }, { TYPE_HEROIC_TBC, 556 }, { TYPE_HEROIC_TBC, 557 }, { TYPE_HEROIC_TBC, 558 }, { TYPE_HEROIC_TBC, 560 },
+        { TYPE_RAID_T4, 532 }, { TYPE_RAID_T4, 544 }, { TYPE_RAID_T4, 565 },
+        { TYPE_RAID_T6, 564 },
+        { TYPE_RAID_ZA, 568 },
+        { TYPE_RAID_SSC, 548 },
+        { TYPE_RAID_HYJAL, 534 }
+    } };
+
+    constexpr uint32 MaxTierMapId = [] { uint32 max = 0; for (TierMap const& tierMap : TierMaps) max = std::max(max, tierMap.MapId); return max; }();
+
+    // Progress slot by map id, -1 for maps which are not part of a tier
+    constexpr std::array<int8, MaxTierMapId + 1> TierSlots = []
+    {
+        std::array<int8, MaxTierMapId + 1> slots{};
+        slots.fill(-1);
+        for (uint8 slot = 0; slot < MYTHIC_PROGRESS_SLOTS; ++slot)
+            slots[TierMaps[slot].MapId] = int8(slot);
+        return slots;
+    }();
+}
 
-                if (hpModifierNormal)
-                    data.NormalOverride = hpModifierNormal;
+ZoneDifficultySnapshot const& ZoneDifficulty::GetSnapshot() const
+{
+    if (!PinnedSnapshot)
+        PinSnapshot();
 
-                sZoneDifficulty->CreatureOverrides[creatureEntry] = data;
-                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New creature with entry: {} has exception for hp: {}", creatureEntry, hpModifier);
-            }
-        } while (result->NextRow());
-    }
-    else
+    return *PinnedSnapshot;
+}
+
+/**
+ *  @brief Pin the latest published snapshot for the calling thread.
+ *  Called at the end of every map update and on every world tick, so the pin only changes between updates
+ *  and all hooks of the next map update the thread runs, whichever map it is, see the same data.
+ */
+void ZoneDifficulty::PinSnapshot() const
+{
+    if (PinnedSnapshot && PinnedSnapshot->Version == _snapshotVersion.load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard<std::mutex> guard(_snapshotLock);
+    PinnedSnapshot = _snapshot;
+}
+
+/**
+ *  @brief Publish a fully built snapshot. Threads pick it up the next time they pin,
+ *  the previous snapshot is released once the last thread let go of it.
+ */
+void ZoneDifficulty::PublishSnapshot(std::shared_ptr<ZoneDifficultySnapshot> snapshot)
+{
     {
-        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT * FROM zone_difficulty_mythicmode_creatureoverrides");
+        std::lock_guard<std::mutex> guard(_snapshotLock);
+        snapshot->Version = _snapshot->Version + 1;
+        _snapshot = std::move(snapshot);
+        _snapshotVersion.store(_snapshot->Version, std::memory_order_release);
     }
 
-    if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_mythicmode_ai"))
+    PinSnapshot();
+}
+
+void ZoneDifficulty::LoadMapDifficultySettings()
+{
+    if (!sZoneDifficulty->IsEnabled)
+        return;
+
+    // Build the new data off to the side, the published snapshot is still in use by the map threads
+    std::shared_ptr<ZoneDifficultySnapshot> snapshot = std::make_shared<ZoneDifficultySnapshot>();
+
+    // Default values for when there is no entry in the db for duels (index 0xFFFFFFFF)
+    snapshot->NerfInfo[DUEL_INDEX][0].HealingNerfPct = 1;
+    snapshot->NerfInfo[DUEL_INDEX][0].AbsorbNerfPct = 1;
+    snapshot->NerfInfo[DUEL_INDEX][0].MeleeDamageBuffPct = 1;
+    snapshot->NerfInfo[DUEL_INDEX][0].SpellDamageBuffPct = 1;
+    snapshot->NerfInfo[DUEL_INDEX][0].HealingNerfPctHard = 1;
+    snapshot->NerfInfo[DUEL_INDEX][0].AbsorbNerfPctHard = 1;
+    snapshot->NerfInfo[DUEL_INDEX][0].MeleeDamageBuffPctHard = 1;
+    snapshot->NerfInfo[DUEL_INDEX][0].SpellDamageBuffPctHard = 1;
+
+    // Heroic Quest -> MapId Translation
+    snapshot->HeroicTBCQuestMapList[542] = 11362; // Blood Furnace
+    snapshot->HeroicTBCQuestMapList[543] = 11354; // Hellfire Ramparts
+    snapshot->HeroicTBCQuestMapList[547] = 11368; // Slave Pens
+    snapshot->HeroicTBCQuestMapList[546] = 11369; // The Underbog
+    snapshot->HeroicTBCQuestMapList[557] = 11373; // Mana-Tombs
+    snapshot->HeroicTBCQuestMapList[558] = 11374; // Auchenai Crypts
+    snapshot->HeroicTBCQuestMapList[560] = 11378; // The Escape From Durnholde
+    snapshot->HeroicTBCQuestMapList[556] = 11372; // Sethekk Halls
+    snapshot->HeroicTBCQuestMapList[585] = 11499; // Magisters' Terrace
+    snapshot->HeroicTBCQuestMapList[555] = 11375; // Shadow Labyrinth
+    snapshot->HeroicTBCQuestMapList[540] = 11363; // Shattered Halls
+    snapshot->HeroicTBCQuestMapList[552] = 11388; // The Arcatraz
+    snapshot->HeroicTBCQuestMapList[269] = 11382; // The Black Morass
+    snapshot->HeroicTBCQuestMapList[553] = 11384; // The Botanica
+    snapshot->HeroicTBCQuestMapList[554] = 11386; // The Mechanar
+    snapshot->HeroicTBCQuestMapList[545] = 11370; // The Steamvault
+
+    // Category 8
+    snapshot->EncounterCounter[542] = 3; // Blood Furnace
+    snapshot->EncounterCounter[543] = 3; // Hellfire Ramparts
+    snapshot->EncounterCounter[547] = 3; // Slave Pens
+    snapshot->EncounterCounter[546] = 4; // The Underbog
+    snapshot->EncounterCounter[557] = 4; // Mana-Tombs
+    snapshot->EncounterCounter[558] = 2; // Auchenai Crypts
+    snapshot->EncounterCounter[560] = 3; // The Escape From Durnholde
+    snapshot->EncounterCounter[556] = 3; // Sethekk Halls
+    //snapshot->EncounterCounter[585] = 4; // Magisters' Terrace
+    snapshot->EncounterCounter[555] = 4; // Shadow Labyrinth
+    snapshot->EncounterCounter[540] = 4; // Shattered Halls
+    snapshot->EncounterCounter[552] = 4; // The Arcatraz
+    snapshot->EncounterCounter[269] = 3; // The Black Morass
+    snapshot->EncounterCounter[553] = 5; // The Botanica
+    snapshot->EncounterCounter[554] = 3; // The Mechanar
+    snapshot->EncounterCounter[545] = 3; // The Steamvault
+
+    // Category 9
+    snapshot->EncounterCounter[565] = 2; // Gruul's Lair
+    snapshot->EncounterCounter[544] = 1; // Magtheridon's Lair
+    snapshot->EncounterCounter[532] = 12; // Karazhan
+
+    // Category 10
+    snapshot->EncounterCounter[548] = 7; // Serpentshrine Cavern
+
+    // Category 11
+    snapshot->EncounterCounter[564] = 9; // Black Temple
+
+    // Category 12
+    snapshot->EncounterCounter[568] = 6; // Zul'Aman
+
+    // Category 18
+    snapshot->EncounterCounter[534] = 5; // Hyjal Summit
+
+    // Icons
+    snapshot->ItemIcons[ITEMTYPE_MISC] = "|TInterface\\icons\\inv_misc_cape_17:15|t |TInterface\\icons\\inv_misc_gem_topaz_02:15|t |TInterface\\icons\\inv_jewelry_ring_51naxxramas:15|t ";
+    snapshot->ItemIcons[ITEMTYPE_CLOTH] = "|TInterface\\icons\\inv_chest_cloth_42:15|t ";
+    snapshot->ItemIcons[ITEMTYPE_LEATHER] = "|TInterface\\icons\\inv_helmet_41:15|t ";
+    snapshot->ItemIcons[ITEMTYPE_MAIL] = "|TInterface\\icons\\inv_chest_chain_13:15|t ";
+    snapshot->ItemIcons[ITEMTYPE_PLATE] = "|TInterface\\icons\\inv_chest_plate12:15|t ";
+    snapshot->ItemIcons[ITEMTYPE_WEAPONS] = "|TInterface\\icons\\inv_mace_25:15|t |TInterface\\icons\\inv_shield_27:15|t |TInterface\\icons\\inv_weapon_crossbow_04:15|t ";
+
+    uint32 oldMSTime = getMSTime();
+    std::optional<uint64> checksum;
+    if (!TuningCacheFile.empty())
+        checksum = ZoneDifficultyTuningCache::Checksum();
+
+    if (checksum)
     {
-        do
+        if (ZoneDifficultyTuningCache::Load(TuningCacheFile, *checksum, *snapshot))
         {
-            bool enabled = (*result)[12].Get<bool>();
+            LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loaded the tuning data from {} in {} ms, the world tables did not change.", TuningCacheFile, GetMSTimeDiffToNow(oldMSTime));
+            snapshot->BuildMapFlags();
+            snapshot->BuildTierRequirements();
+            PublishSnapshot(std::move(snapshot));
+            return;
+        }
+    }
+
+    // The tables fill different members of the snapshot, so each is queried and parsed on its own thread
+    std::vector<std::future<TableLoadTime> > loads;
 
-            if (enabled)
+    loads.push_back(LoadTableAsync("zone_difficulty_info", [&snapshot]()
+    {
+        uint64 rows = 0;
+
+        if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_info WHERE Enabled > 0"))
+        {
+            rows = result->GetRowCount();
+            do
             {
-                uint32 creatureEntry = (*result)[0].Get<uint32>();
-                ZoneDifficultyHAI data;
-                data.Chance = (*result)[1].Get<uint8>();
-                data.Spell = (*result)[2].Get<uint32>();
-                data.Spellbp0 = (*result)[3].Get<int32>();
-                data.Spellbp1 = (*result)[4].Get<int32>();
-                data.Spellbp2 = (*result)[5].Get<int32>();
-                data.Target = (*result)[6].Get<uint8>();
-                data.TargetArg = (*result)[7].Get<int8>();
-                data.TargetArg2 = (*result)[8].Get<uint8>();
-                data.Delay = (*result)[9].Get<Milliseconds>();
-                data.Cooldown = (*result)[10].Get<Milliseconds>();
-                data.Repetitions = (*result)[11].Get<uint8>();
-                data.TriggeredCast = (*result)[13].Get<bool>();
-
-                if (data.Chance != 0 && data.Spell != 0 && ((data.Target >= 1 && data.Target <= 6) || data.Target == 18))
+                uint32 mapId = (*result)[0].Get<uint32>();
+                uint32 phaseMask = (*result)[1].Get<uint32>();
+                ZoneDifficultyNerfData data;
+                int8 mode = (*result)[6].Get<int8>();
+
+                if (sZoneDifficulty->HasNormalMode(mode))
                 {
-                    sZoneDifficulty->MythicmodeAI[creatureEntry].push_back(data);
-                    LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New AI for entry {} with spell {}", creatureEntry, data.Spell);
+                    data.HealingNerfPct = (*result)[2].Get<float>();
+                    data.AbsorbNerfPct = (*result)[3].Get<float>();
+                    data.MeleeDamageBuffPct = (*result)[4].Get<float>();
+                    data.SpellDamageBuffPct = (*result)[5].Get<float>();
+                    data.Enabled = data.Enabled | mode;
+                    snapshot->NerfInfo[mapId][phaseMask] = data;
                 }
-                else
+                if (sZoneDifficulty->HasMythicmode(mode) && sZoneDifficulty->MythicmodeEnable)
                 {
-                    LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Unknown type for `Target`: {} in zone_difficulty_mythicmode_ai", data.Target);
+                    data.HealingNerfPctHard = (*result)[2].Get<float>();
+                    data.AbsorbNerfPctHard = (*result)[3].Get<float>();
+                    data.MeleeDamageBuffPctHard = (*result)[4].Get<float>();
+                    data.SpellDamageBuffPctHard = (*result)[5].Get<float>();
+                    data.Enabled = data.Enabled | mode;
+                    snapshot->NerfInfo[mapId][phaseMask] = data;
                 }
-                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New creature with entry: {} has exception for hp: {}", creatureEntry, hpModifier);
-            }
-        } while (result->NextRow());
-    }
-    else
-    {
-        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT * FROM zone_difficulty_mythicmode_ai");
-    }
+                if ((mode & MODE_HARD) != MODE_HARD && (mode & MODE_NORMAL) != MODE_NORMAL)
+                {
+                    LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Invalid mode {} used in Enabled for mapId {}, ignored.", mode, mapId);
+                }
+
+                // duels do not check for phases. Only 0 is allowed.
+                if (mapId == DUEL_INDEX && phaseMask != 0)
+                {
+                    LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Table `zone_difficulty_info` for criteria (duel mapId: {}) has wrong value ({}), must be 0 for duels.", mapId, phaseMask);
+                }
+
+            } while (result->NextRow());
+        }
+
+        snapshot->BuildNerfTable();
+
+        return rows;
+    }));
 
-    //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Starting load of rewards.");
-    if (QueryResult result = WorldDatabase.Query("SELECT ContentType, ItemType, Entry, Price, Enchant, EnchantSlot, Achievement, Enabled FROM zone_difficulty_mythicmode_rewards"))
+    loads.push_back(LoadTableAsync("zone_difficulty_spelloverrides", [&snapshot]()
     {
-        /* debug
-         * uint32 i = 0;
-         * end debug
-         */
-        do
+        uint64 rows = 0;
+
+        if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_spelloverrides"))
         {
-            /* debug
-             * ++i;
-             * end debug
-             */
-            ZoneDifficultyRewardData data;
-            uint32 contentType = (*result)[0].Get<uint32>();
-            uint32 itemType = (*result)[1].Get<uint32>();
-            data.Entry = (*result)[2].Get<uint32>();
-            data.Price = (*result)[3].Get<uint32>();
-            data.Enchant = (*result)[4].Get<uint32>();
-            data.EnchantSlot = (*result)[5].Get<uint8>();
-            data.Achievement = (*result)[6].Get<int32>();
-            bool enabled = (*result)[7].Get<bool>();
-
-            if (enabled)
+            rows = result->GetRowCount();
+            do
             {
-                if (data.Achievement >= 0)
+                if ((*result)[3].Get<uint8>() > 0)
                 {
-                    sZoneDifficulty->Rewards[contentType][itemType].push_back(data);
-                    //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading item with entry {} has enchant {} in slot {}. contentType: {} itemType: {}", data.Entry, data.Enchant, data.EnchantSlot, contentType, itemType);
+                    snapshot->SpellNerfOverrides[(*result)[0].Get<uint32>()][(*result)[1].Get<uint32>()].NerfPct = (*result)[2].Get<float>();
+                    snapshot->SpellNerfOverrides[(*result)[0].Get<uint32>()][(*result)[1].Get<uint32>()].ModeMask = (*result)[3].Get<uint32>();
                 }
-                else
+
+            } while (result->NextRow());
+        }
+
+        snapshot->SpellOverrideIndex.Build(snapshot->SpellNerfOverrides);
+
+        return rows;
+    }));
+
+    loads.push_back(LoadTableAsync("zone_difficulty_disallowed_buffs", [&snapshot]()
+    {
+        uint64 rows = 0;
+
+        if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_disallowed_buffs"))
+        {
+            rows = result->GetRowCount();
+            do
+            {
+                std::vector<uint32> debuffs;
+                uint32 mapId = 0;
+                if ((*result)[2].Get<bool>())
                 {
-                    sZoneDifficulty->TierRewards[contentType] = data;
-                    //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading tier reward with entry {} has enchant {} in slot {}. contentType: {} itemType: {}", data.Entry, data.Enchant, data.EnchantSlot, contentType, itemType);
+                    std::string spellString = (*result)[1].Get<std::string>();
+                    std::vector<std::string_view> tokens = Acore::Tokenize(spellString, ' ', false);
+
+                    mapId = (*result)[0].Get<uint32>();
+                    for (auto token : tokens)
+                    {
+                        if (token.empty())
+                            continue;
+
+                        uint32 spell = 0;
+                        if ((spell = Acore::StringTo<uint32>(token).value()))
+                            debuffs.push_back(spell);
+                        else
+                            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Disabling buffs for spell '{}' is invalid, skipped.", spell);
+                    }
+                    snapshot->DisallowedBuffs[mapId] = debuffs;
                 }
-            }
-            //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Total items in Rewards map: {}.", i);
-        } while (result->NextRow());
-    }
-    else
-    {
-        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT ContentType, ItemType, Entry, Price, Enchant, EnchantSlot, Achievement, Enabled FROM zone_difficulty_mythicmode_rewards");
-    }
-}
+            } while (result->NextRow());
+        }
 
-/**
- *  @brief Loads the MythicmodeInstanceData from the database. Fetch from zone_difficulty_instance_saves.
- *
- *  `InstanceID` INT NOT NULL DEFAULT 0,
- *  `MythicmodeOn` TINYINT NOT NULL DEFAULT 0,
- *
- *  Exclude data not in the IDs stored in GetInstanceIDs() and delete
- *  zone_difficulty_instance_saves for instances that no longer exist.
- */
-void ZoneDifficulty::LoadMythicmodeInstanceData()
-{
-    std::vector<bool> instanceIDs = sMapMgr->GetInstanceIDs();
-    /* debugging
-    * for (int i = 0; i < int(instanceIDs.size()); i++)
-    * {
-    *   LOG_INFO("module", "MOD-ZONE-DIFFICULTY: ZoneDifficulty::LoadMythicmodeInstanceData: id {} exists: {}:", i, instanceIDs[i]);
-    * }
-    * end debugging
-    */
-    if (QueryResult result = CharacterDatabase.Query("SELECT * FROM zone_difficulty_instance_saves"))
+        return rows;
+    }));
+
+    loads.push_back(LoadTableAsync("zone_difficulty_mythicmode_instance_data", [&snapshot]()
     {
-        do
-        {
-            uint32 InstanceId = (*result)[0].Get<uint32>();
-            bool MythicmodeOn = (*result)[1].Get<bool>();
+        uint64 rows = 0;
 
-            if (instanceIDs[InstanceId])
-            {
-                LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading from DB for instanceId {}: MythicmodeOn = {}", InstanceId, MythicmodeOn);
-                sZoneDifficulty->MythicmodeInstanceData[InstanceId] = MythicmodeOn;
-            }
-            else
+        if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_mythicmode_instance_data"))
+        {
+            rows = result->GetRowCount();
+            do
             {
-                CharacterDatabase.Execute("DELETE FROM zone_difficulty_instance_saves WHERE InstanceID = {}", InstanceId);
-            }
+                ZoneDifficultyMythicmodeMapData data;
+                uint32 MapID = (*result)[0].Get<uint32>();
+                data.EncounterEntry = (*result)[1].Get<uint32>();
+                data.Override = (*result)[2].Get<uint32>();
+                data.RewardType = (*result)[3].Get<uint8>();
 
+                snapshot->MythicmodeLoot[MapID].push_back(data);
+                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New creature for map {} with entry: {}", MapID, data.EncounterEntry);
 
-        } while (result->NextRow());
-    }
-}
+                snapshot->Expansion[MapID] = data.RewardType;
 
-/**
- *  @brief Loads the score data and encounter logs from the database.
- *  Fetch from zone_difficulty_mythicmode_score.
- *
- *  `CharacterGuid` INT NOT NULL DEFAULT 0,
- *  `Type` TINYINT NOT NULL DEFAULT 0,
- *  `Score` INT NOT NULL DEFAULT 0,
- *
- *  Fetch from zone_difficulty_encounter_logs.
- *  `InstanceId` INT NOT NULL DEFAULT 0,
- *  `TimestampStart` INT NOT NULL DEFAULT 0,
- *  `TimestampEnd` INT NOT NULL DEFAULT 0,
- *  `Map` INT NOT NULL DEFAULT 0,
- *  `BossId` INT NOT NULL DEFAULT 0,
- *  `PlayerGuid` INT NOT NULL DEFAULT 0,
- *  `Mode` INT NOT NULL DEFAULT 0,
- *
- */
-void ZoneDifficulty::LoadMythicmodeScoreData()
-{
-    if (QueryResult result = CharacterDatabase.Query("SELECT * FROM zone_difficulty_mythicmode_score"))
-    {
-        do
+            } while (result->NextRow());
+        }
+        else
         {
-            uint32 GUID = (*result)[0].Get<uint32>();
-            uint8 Type = (*result)[1].Get<uint8>();
-            uint32 Score = (*result)[2].Get<uint32>();
-
-            //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading from DB for player with GUID {}: Type = {}, Score = {}", GUID, Type, Score);
-            sZoneDifficulty->MythicmodeScore[GUID][Type] = Score;
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT * FROM zone_difficulty_mythicmode_instance_data");
+        }
 
-        } while (result->NextRow());
-    }
+        return rows;
+    }));
 
-    if (QueryResult result = CharacterDatabase.Query("SELECT `Map`, `BossId`, `PlayerGuid` FROM zone_difficulty_encounter_logs WHERE `Mode` = 64"))
+    loads.push_back(LoadTableAsync("pool_quest", [&snapshot]()
     {
-        do
-        {
-            uint32 MapId = (*result)[0].Get<uint32>();
-            uint8 BossID = (*result)[1].Get<uint32>();
-            uint32 PlayerGuid = (*result)[2].Get<uint32>();
+        uint64 rows = 0;
 
-            // Set all BossID which aren't true to false for that mapID
-            if (sZoneDifficulty->Logs[PlayerGuid].find(MapId) == sZoneDifficulty->Logs[PlayerGuid].end())
+        if (QueryResult result = WorldDatabase.Query("SELECT entry FROM `pool_quest` WHERE `pool_entry`=356"))
+        {
+            rows = result->GetRowCount();
+            do
+            {
+                snapshot->DailyHeroicQuests.push_back((*result)[0].Get<uint32>());
+                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Adding daily heroic quest with id {}.", (*result)[0].Get<uint32>());
+            } while (result->NextRow());
+        }
+        else
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT entry FROM `pool_quest` WHERE `pool_entry`=356");
+        }
+
+        return rows;
+    }));
+
+    loads.push_back(LoadTableAsync("zone_difficulty_mythicmode_creatureoverrides", [&snapshot]()
+    {
+        uint64 rows = 0;
+
+        if (QueryResult result = WorldDatabase.Query("SELECT * FROM zone_difficulty_mythicmode_creatureoverrides"))
+        {
+            rows = result->GetRowCount();
+            do
+            {
+                uint32 creatureEntry = (*result)[0].Get<uint32>();
+                float hpModifier = (*result)[1].Get<float>();
+                float hpModifierNormal = (*result)[2].Get<float>();
+                bool enabled = (*result)[3].Get<bool>();
+
+                if (enabled)
+                {
+                    CreatureOverrideData data;
+                    if (hpModifier)
+                        data.MythicOverride = hpModifier;
+
+                    if (hpModifierNormal)
+                        data.NormalOverride = hpModifierNormal;
+
+                    snapshot->CreatureOverrides[creatureEntry] = data;
+                    //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New creature with entry: {} has exception for hp: {}", creatureEntry, hpModifier);
+                }
+            } while (result->NextRow());
+        }
+        else
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT * FROM zone_difficulty_mythicmode_creatureoverrides");
+        }
+
+        return rows;
+    }));
+
+    loads.push_back(LoadTableAsync("zone_difficulty_mythicmode_ai", [&snapshot]()
+    {
+        uint64 rows = 0;
+
+        std::map<uint32, std::vector<ZoneDifficultyHAI> > mythicPrograms;
+        uint32 rejectedAbilities = 0;
+        if (QueryResult result = WorldDatabase.Query("SELECT CreatureEntry, Chance, Spell, Spellbp0, Spellbp1, Spellbp2, Target, TargetArg, TargetArg2, Delay, Cooldown, Repetitions, Enabled, TriggeredCast, Priority FROM zone_difficulty_mythicmode_ai"))
+        {
+            rows = result->GetRowCount();
+            do
+            {
+                bool enabled = (*result)[12].Get<bool>();
+
+                if (enabled)
+                {
+                    uint32 creatureEntry = (*result)[0].Get<uint32>();
+                    MythicAbilityRow row;
+                    row.Chance = (*result)[1].Get<uint8>();
+                    row.Spell = (*result)[2].Get<uint32>();
+                    row.Spellbp[0] = (*result)[3].Get<int32>();
+                    row.Spellbp[1] = (*result)[4].Get<int32>();
+                    row.Spellbp[2] = (*result)[5].Get<int32>();
+                    row.Target = (*result)[6].Get<uint8>();
+                    row.TargetArg = (*result)[7].Get<int8>();
+                    row.TargetArg2 = (*result)[8].Get<uint8>();
+                    row.Delay = (*result)[9].Get<Milliseconds>();
+                    row.Cooldown = (*result)[10].Get<Milliseconds>();
+                    row.Repetitions = (*result)[11].Get<uint8>();
+                    row.TriggeredCast = (*result)[13].Get<bool>();
+                    row.Priority = (*result)[14].Get<uint8>();
+
+                    ZoneDifficultyHAI data;
+                    if (CompileMythicAbility(creatureEntry, row, data))
+                    {
+                        mythicPrograms[creatureEntry].push_back(data);
+                        LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New AI for entry {} with spell {}", creatureEntry, data.SpellId);
+                    }
+                    else
+                        ++rejectedAbilities;
+                    //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: New creature with entry: {} has exception for hp: {}", creatureEntry, hpModifier);
+                }
+            } while (result->NextRow());
+        }
+        else
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT CreatureEntry, Chance, Spell, Spellbp0, Spellbp1, Spellbp2, Target, TargetArg, TargetArg2, Delay, Cooldown, Repetitions, Enabled, TriggeredCast, Priority FROM zone_difficulty_mythicmode_ai");
+        }
+
+        // Lay the programs out back to back, so all abilities of a creature share consecutive cache lines
+        for (auto const& [creatureEntry, program] : mythicPrograms)
+        {
+            ZoneDifficultyAbilityProgram& entry = snapshot->MythicmodeAI[creatureEntry];
+            entry.First = snapshot->MythicmodeAbilities.size();
+            entry.Count = program.size();
+            snapshot->MythicmodeAbilities.insert(snapshot->MythicmodeAbilities.end(), program.begin(), program.end());
+        }
+
+        LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Compiled {} Mythicmode AI abilities for {} creatures, {} rows rejected.", snapshot->MythicmodeAbilities.size(), snapshot->MythicmodeAI.size(), rejectedAbilities);
+
+        return rows;
+    }));
+
+    loads.push_back(LoadTableAsync("zone_difficulty_mythicmode_rewards", [&snapshot]()
+    {
+        uint64 rows = 0;
+
+        //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Starting load of rewards.");
+        if (QueryResult result = WorldDatabase.Query("SELECT ContentType, ItemType, Entry, Price, Enchant, EnchantSlot, Achievement, Enabled FROM zone_difficulty_mythicmode_rewards"))
+        {
+            rows = result->GetRowCount();
+            /* debug
+             * uint32 i = 0;
+             * end debug
+             */
+            do
             {
-                for (int i = 0; i < sZoneDifficulty->EncounterCounter[MapId]; ++i)
+                /* debug
+                 * ++i;
+                 * end debug
+                 */
+                ZoneDifficultyRewardData data;
+                uint32 contentType = (*result)[0].Get<uint32>();
+                uint32 itemType = (*result)[1].Get<uint32>();
+                data.Entry = (*result)[2].Get<uint32>();
+                data.Price = (*result)[3].Get<uint32>();
+                data.Enchant = (*result)[4].Get<uint32>();
+                data.EnchantSlot = (*result)[5].Get<uint8>();
+                data.Achievement = (*result)[6].Get<int32>();
+                bool enabled = (*result)[7].Get<bool>();
+
+                if (enabled)
                 {
-                    LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Initializing player record for PlayerGuid {} in MapId {} for BossId {}: False", PlayerGuid, MapId, i);
-                    sZoneDifficulty->Logs[PlayerGuid][MapId][i] = false;
+                    if (data.Achievement >= 0)
+                    {
+                        snapshot->Rewards[contentType][itemType].push_back(data);
+                        //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading item with entry {} has enchant {} in slot {}. contentType: {} itemType: {}", data.Entry, data.Enchant, data.EnchantSlot, contentType, itemType);
+                    }
+                    else
+                    {
+                        snapshot->TierRewards[contentType] = data;
+                        //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading tier reward with entry {} has enchant {} in slot {}. contentType: {} itemType: {}", data.Entry, data.Enchant, data.EnchantSlot, contentType, itemType);
+                    }
                 }
+                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Total items in Rewards map: {}.", i);
+            } while (result->NextRow());
+        }
+        else
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Query failed: SELECT ContentType, ItemType, Entry, Price, Enchant, EnchantSlot, Achievement, Enabled FROM zone_difficulty_mythicmode_rewards");
+        }
+
+        return rows;
+    }));
+
+    WaitForTableLoads(loads, "world", oldMSTime);
+
+    if (checksum)
+        ZoneDifficultyTuningCache::Save(TuningCacheFile, *checksum, *snapshot);
+
+    snapshot->BuildMapFlags();
+    snapshot->BuildTierRequirements();
+    PublishSnapshot(std::move(snapshot));
+}
+
+/**
+ *  @brief Gather what the module does per map into one byte per map id, so hooks
+ *  on maps the module does not care about return after a single bit test.
+ */
+void ZoneDifficultySnapshot::BuildMapFlags()
+{
+    uint32 maxMapId = DUEL_MAP;
+    for (auto const& [mapId, phases] : NerfInfo)
+        if (mapId != DUEL_INDEX)
+            maxMapId = std::max<uint32>(maxMapId, mapId);
+    for (auto const& [mapId, loot] : MythicmodeLoot)
+        maxMapId = std::max(maxMapId, mapId);
+    for (auto const& [mapId, buffs] : DisallowedBuffs)
+        maxMapId = std::max(maxMapId, mapId);
+
+    MapFlags.assign(maxMapId + 1, 0);
+
+    for (uint32 mapId = 0; mapId < NerfMaps.size(); ++mapId)
+        if (ShouldNerfMap(mapId))
+            MapFlags[mapId] |= MAP_FLAG_NERF | MAP_FLAG_CREATURE_SCALING;
+
+    if (DuelNerfEnabled)
+        MapFlags[DUEL_MAP] |= MAP_FLAG_DUEL_NERF;
+
+    for (auto const& [mapId, loot] : MythicmodeLoot)
+        MapFlags[mapId] |= MAP_FLAG_MYTHIC;
+
+    for (auto const& [mapId, buffs] : DisallowedBuffs)
+        MapFlags[mapId] |= MAP_FLAG_DISALLOWED_BUFFS;
+}
+
+/**
+ *  @brief Precompute per tier which bits of the progress slots have to be set for a full tier.
+ */
+void ZoneDifficultySnapshot::BuildTierRequirements()
+{
+    TierRequirements.clear();
+    std::set<uint8> incomplete;
+
+    for (uint8 slot = 0; slot < MYTHIC_PROGRESS_SLOTS; ++slot)
+    {
+        TierMap const& tierMap = TierMaps[slot];
+        auto counter = EncounterCounter.find(tierMap.MapId);
+        if (counter == EncounterCounter.end() || counter->second > 64)
+        {
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Map {} of category {} has no valid encounter count, the tier can not be completed.", tierMap.MapId, tierMap.Category);
+            incomplete.insert(tierMap.Category);
+            continue;
+        }
+
+        TierRequirements[tierMap.Category][slot] = counter->second == 64 ? ~uint64(0) : (uint64(1) << counter->second) - 1;
+    }
+
+    for (uint8 category : incomplete)
+        TierRequirements.erase(category);
+}
+
+/**
+ *  @brief Flatten NerfInfo into the dense tables read by the unit hooks.
+ *
+ *  Every tuned map gets a contiguous block of phase slots ordered by PhaseMask, the same
+ *  order GetLowestMatchingPhase walks NerfInfo in. Each slot holds the final multipliers
+ *  for normal and mythic mode, with 1.0 for modes which are not enabled in the row.
+ */
+void ZoneDifficultySnapshot::BuildNerfTable()
+{
+    NerfMaps.clear();
+    NerfPhaseKeys.clear();
+    NerfPhaseBitSlots.clear();
+    NerfTable.clear();
+
+    uint32 maxMapId = 0;
+    for (auto const& [mapId, phases] : NerfInfo)
+        if (mapId != uint32(DUEL_INDEX))
+            maxMapId = std::max(maxMapId, mapId);
+
+    NerfMaps.resize(maxMapId + 1);
+
+    for (auto const& [mapId, phases] : NerfInfo)
+    {
+        if (mapId == uint32(DUEL_INDEX))
+            continue;
+
+        ZoneDifficultyNerfMapEntry& entry = NerfMaps[mapId];
+        entry.FirstSlot = NerfPhaseKeys.size();
+        entry.PhaseBitOffset = NerfPhaseBitSlots.size();
+        NerfPhaseBitSlots.resize(NerfPhaseBitSlots.size() + 32, 0);
+
+        for (auto const& [phaseMask, data] : phases)
+        {
+            if (entry.PhaseCount == MAX_NERF_PHASE_SLOTS)
+            {
+                LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Table `zone_difficulty_info` has more than {} phases for mapId {}, PhaseMask {} ignored.", MAX_NERF_PHASE_SLOTS, mapId, phaseMask);
+                continue;
+            }
+
+            uint32 slot = entry.PhaseCount++;
+            if (phaseMask == 0)
+                entry.AllPhases = true;
+
+            for (uint8 bit = 0; bit < 32; ++bit)
+                if (phaseMask & (1u << bit))
+                    NerfPhaseBitSlots[entry.PhaseBitOffset + bit] |= 1u << slot;
+
+            ZoneDifficultyNerfMultipliers normal;
+            ZoneDifficultyNerfMultipliers mythic;
+
+            if (ZoneDifficulty::HasNormalMode(data.Enabled))
+            {
+                normal.Healing = data.HealingNerfPct;
+                normal.Absorb = data.AbsorbNerfPct;
+                normal.SpellDamage = data.SpellDamageBuffPct;
+                normal.MeleeDamage = data.MeleeDamageBuffPct;
+            }
+
+            if (ZoneDifficulty::HasMythicmode(data.Enabled))
+            {
+                mythic.Healing = data.HealingNerfPctHard;
+                mythic.Absorb = data.AbsorbNerfPctHard;
+                mythic.SpellDamage = data.SpellDamageBuffPctHard;
+                mythic.MeleeDamage = data.MeleeDamageBuffPctHard;
+            }
+
+            NerfPhaseKeys.push_back(phaseMask);
+            NerfTable.push_back(normal);
+            NerfTable.push_back(mythic);
+        }
+    }
+
+    ZoneDifficultyNerfData const& duel = NerfInfo[DUEL_INDEX][0];
+    DuelNerf.Healing = duel.HealingNerfPct;
+    DuelNerf.Absorb = duel.AbsorbNerfPct;
+    DuelNerf.SpellDamage = duel.SpellDamageBuffPct;
+    DuelNerf.MeleeDamage = duel.MeleeDamageBuffPct;
+    DuelNerfEnabled = duel.Enabled > 0;
+}
+
+std::vector<ZoneDifficultyRewardData> const* ZoneDifficultySnapshot::GetRewards(uint32 category, uint32 itemType) const
+{
+    auto categoryItr = Rewards.find(category);
+    if (categoryItr == Rewards.end())
+        return nullptr;
+
+    auto typeItr = categoryItr->second.find(itemType);
+    if (typeItr == categoryItr->second.end())
+        return nullptr;
+
+    return &typeItr->second;
+}
+
+ZoneDifficultyRewardData const* ZoneDifficultySnapshot::GetReward(uint32 category, uint32 itemType, uint32 counter) const
+{
+    std::vector<ZoneDifficultyRewardData> const* rewards = GetRewards(category, itemType);
+    if (!rewards || counter >= rewards->size())
+        return nullptr;
+
+    return &(*rewards)[counter];
+}
+
+ZoneDifficultyRewardData const* ZoneDifficultySnapshot::GetTierReward(uint32 category) const
+{
+    auto itr = TierRewards.find(category);
+    return itr != TierRewards.end() ? &itr->second : nullptr;
+}
+
+/**
+ *  @brief The compiled Mythicmode AI abilities of a creature entry, in row order. Empty if it has none.
+ */
+std::span<ZoneDifficultyHAI const> ZoneDifficultySnapshot::GetMythicProgram(uint32 entry) const
+{
+    auto itr = MythicmodeAI.find(entry);
+    if (itr == MythicmodeAI.end())
+        return {};
+
+    return std::span<ZoneDifficultyHAI const>(MythicmodeAbilities).subspan(itr->second.First, itr->second.Count);
+}
+
+ZoneDifficultyHAI const* ZoneDifficultySnapshot::GetMythicAbility(uint32 entry, uint32 index) const
+{
+    std::span<ZoneDifficultyHAI const> program = GetMythicProgram(entry);
+    return index < program.size() ? &program[index] : nullptr;
+}
+
+/**
+ *  @brief Classify every spell of the spell store once, so the unit hooks
+ *  can decide on exemptions with a single lookup instead of scanning effects.
+ */
+void ZoneDifficulty::LoadSpellClasses()
+{
+    uint32 oldMSTime = getMSTime();
+    uint32 storeSize = sSpellMgr->GetSpellInfoStoreSize();
+    SpellClasses.assign(storeSize, 0);
+
+    for (uint32 spellId = 0; spellId < storeSize; ++spellId)
+    {
+        SpellInfo const* spellInfo = sSpellMgr->GetSpellInfo(spellId);
+        if (!spellInfo)
+            continue;
+
+        uint8 flags = 0;
+
+        if (spellInfo->HasAttribute(SPELL_ATTR0_NO_IMMUNITIES))
+            flags |= SPELL_CLASS_NO_IMMUNITIES | SPELL_CLASS_EXEMPT_HEAL;
+
+        if (spellInfo->Mechanic == MECHANIC_BANDAGE || spellInfo->HasEffect(SPELL_EFFECT_HEALTH_LEECH))
+            flags |= SPELL_CLASS_EXEMPT_HEAL;
+
+        for (SpellEffectInfo const& eff : spellInfo->GetEffects())
+        {
+            switch (eff.ApplyAuraName)
+            {
+                case SPELL_AURA_PERIODIC_LEECH:
+                    flags |= SPELL_CLASS_EXEMPT_HEAL;
+                    break;
+                case SPELL_AURA_PERIODIC_DAMAGE:
+                case SPELL_AURA_PERIODIC_DAMAGE_PERCENT:
+                    flags |= SPELL_CLASS_DOT;
+                    break;
+                case SPELL_AURA_SCHOOL_ABSORB:
+                    flags |= SPELL_CLASS_SCHOOL_ABSORB;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        SpellClasses[spellId] = flags;
+    }
+
+    LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Classified {} spells in {} ms.", storeSize, GetMSTimeDiffToNow(oldMSTime));
+}
+
+/**
+ *  @brief Load the character tables of the module, each on its own thread.
+ */
+void ZoneDifficulty::LoadCharacterData()
+{
+    uint32 oldMSTime = getMSTime();
+    std::vector<std::future<TableLoadTime> > loads;
+    loads.push_back(LoadTableAsync("zone_difficulty_instance_saves", [this]() { return LoadMythicmodeInstanceData(); }));
+    loads.push_back(LoadTableAsync("zone_difficulty_mythicmode_score", [this]() { return LoadMythicmodeScoreData(); }));
+    WaitForTableLoads(loads, "character", oldMSTime);
+}
+
+/**
+ *  @brief Loads the mythic flag of every instance from the database. Fetch from zone_difficulty_instance_saves.
+ *
+ *  `InstanceID` INT NOT NULL DEFAULT 0,
+ *  `MythicmodeOn` TINYINT NOT NULL DEFAULT 0,
+ *
+ *  Exclude data not in the IDs stored in GetInstanceIDs() and delete
+ *  zone_difficulty_instance_saves for instances that no longer exist.
+ */
+uint64 ZoneDifficulty::LoadMythicmodeInstanceData()
+{
+    std::vector<bool> instanceIDs = sMapMgr->GetInstanceIDs();
+    /* debugging
+    * for (int i = 0; i < int(instanceIDs.size()); i++)
+    * {
+    *   LOG_INFO("module", "MOD-ZONE-DIFFICULTY: ZoneDifficulty::LoadMythicmodeInstanceData: id {} exists: {}:", i, instanceIDs[i]);
+    * }
+    * end debugging
+    */
+    uint64 rows = 0;
+    std::set<uint32> staleInstances;
+    if (QueryResult result = CharacterDatabase.Query("SELECT * FROM zone_difficulty_instance_saves"))
+    {
+        rows = result->GetRowCount();
+        do
+        {
+            uint32 InstanceId = (*result)[0].Get<uint32>();
+            bool MythicmodeOn = (*result)[1].Get<bool>();
+
+            if (InstanceId < instanceIDs.size() && instanceIDs[InstanceId])
+            {
+                LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading from DB for instanceId {}: MythicmodeOn = {}", InstanceId, MythicmodeOn);
+                sZoneDifficulty->InstanceStates.SetMythicmode(InstanceId, MythicmodeOn);
             }
-            LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Setting player record for PlayerGuid {} in MapId {} for BossId {}: True", PlayerGuid, MapId, BossID);
-            sZoneDifficulty->Logs[PlayerGuid][MapId][BossID] = true;
+            else
+                staleInstances.insert(InstanceId);
+        } while (result->NextRow());
+    }
+
+    if (!staleInstances.empty())
+    {
+        ZoneDifficultyInstanceSaves::Delete(staleInstances);
+        LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Deleted the Mythicmode flags of {} instances which no longer exist.", staleInstances.size());
+    }
+
+    return rows;
+}
+
+/**
+ *  @brief Loads the score data from the database.
+ *  Fetch from zone_difficulty_mythicmode_score.
+ *
+ *  `CharacterGuid` INT NOT NULL DEFAULT 0,
+ *  `Type` TINYINT NOT NULL DEFAULT 0,
+ *  `Score` INT NOT NULL DEFAULT 0,
+ *
+ *  The encounter logs are loaded per player on login, see ZoneDifficultyProgressCache.
+ */
+uint64 ZoneDifficulty::LoadMythicmodeScoreData()
+{
+    uint64 rows = 0;
+    if (QueryResult result = CharacterDatabase.Query("SELECT * FROM zone_difficulty_mythicmode_score"))
+    {
+        rows = result->GetRowCount();
+        do
+        {
+            uint32 GUID = (*result)[0].Get<uint32>();
+            uint8 Type = (*result)[1].Get<uint8>();
+            uint32 Score = (*result)[2].Get<uint32>();
+
+            //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Loading from DB for player with GUID {}: Type = {}, Score = {}", GUID, Type, Score);
+            sZoneDifficulty->MythicmodeScore[GUID][Type] = Score;
+
         } while (result->NextRow());
     }
+
+    return rows;
 }
 
 /**
@@ -568,7 +1303,7 @@ void ZoneDifficulty::AddMythicmodeScore(Map* map, uint32 type, uint32 score)
         LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: No object for map in AddMythicmodeScore.");
         return;
     }
-    if (type > 255)
+    if (type >= TYPE_MAX_TIERS)
     {
         LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Wrong value for type: {} in AddMythicmodeScore for map with id {}.", type, map->GetInstanceId());
         return;
@@ -576,8 +1311,9 @@ void ZoneDifficulty::AddMythicmodeScore(Map* map, uint32 type, uint32 score)
 
     map->DoForAllPlayers([&](Player* player)
     {
-        uint32 previousScore = player->GetPlayerSetting(ModZoneDifficultyString + "score", type).value;
-        player->UpdatePlayerSetting(ModZoneDifficultyString + "score", type, previousScore + score);
+        ZoneDifficultyScoreLedger& ledger = ZoneDifficultyScoreLedger::Get(player);
+        uint32 previousScore = ledger.GetScore(type);
+        ledger.SetScore(type, previousScore + score);
         std::string typestring = sZoneDifficulty->GetContentTypeString(type);
         ChatHandler(player->GetSession()).PSendSysMessage("You have received Mythicmode score {} New score: {}", typestring, previousScore + score);
     });
@@ -597,12 +1333,60 @@ void ZoneDifficulty::DeductMythicmodeScore(Player* player, uint32 type, uint32 s
         LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Reducing score with type {} from player with guid {} by {}.", type, player->GetGUID().GetCounter(), score);
     }
 
-    uint32 val = player->GetPlayerSetting(ModZoneDifficultyString + "score", type).value - score;
-    player->UpdatePlayerSetting(ModZoneDifficultyString + "score", type, val);
+    ZoneDifficultyScoreLedger& ledger = ZoneDifficultyScoreLedger::Get(player);
+    ledger.SetScore(type, ledger.GetScore(type) - score);
+}
+
+ZoneDifficultyScoreLedger& ZoneDifficultyScoreLedger::Get(Player* player)
+{
+    if (ZoneDifficultyScoreLedger* ledger = player->CustomData.Get<ZoneDifficultyScoreLedger>(ScoreLedgerKey))
+        return *ledger;
+
+    ZoneDifficultyScoreLedger* ledger = player->CustomData.GetDefault<ZoneDifficultyScoreLedger>(ScoreLedgerKey);
+    ledger->Load(player);
+    return *ledger;
+}
+
+void ZoneDifficultyScoreLedger::Load(Player* player)
+{
+    for (uint32 type = 1; type < TYPE_MAX_TIERS; ++type)
+        _scores[type] = player->GetPlayerSetting(ModZoneDifficultyScoreSetting, type).value;
+}
+
+void ZoneDifficultyScoreLedger::SetScore(uint32 type, uint32 score)
+{
+    if (type >= TYPE_MAX_TIERS || _scores[type] == score)
+        return;
+
+    _scores[type] = score;
+    _changed |= 1 << type;
+}
+
+/**
+ *  @brief Write the changed scores of the player into the player settings, which are stored with the player.
+ *
+ *  @param logout The player logs out, the ledger is dropped after writing.
+ */
+void ZoneDifficultyScoreLedger::Save(Player* player, bool logout)
+{
+    ZoneDifficultyScoreLedger* ledger = player->CustomData.Get<ZoneDifficultyScoreLedger>(ScoreLedgerKey);
+    if (!ledger)
+        return;
+
+    for (uint32 changed = ledger->_changed; changed; changed &= changed - 1)
+    {
+        uint32 type = std::countr_zero(changed);
+        player->UpdatePlayerSetting(ModZoneDifficultyScoreSetting, type, ledger->_scores[type]);
+    }
+
+    ledger->_changed = 0;
+
+    if (logout)
+        player->CustomData.Erase(ScoreLedgerKey);
 }
 
 /**
- * @brief Send and item to the player using the data from sZoneDifficulty->Rewards.
+ * @brief Send and item to the player using the data from the published rewards snapshot.
  *
  * @param player The recipient of the mail.
  * @param data The reward data e.g item entry, etc.
@@ -651,10 +1435,7 @@ bool ZoneDifficulty::IsMythicmodeMap(uint32 mapId)
     if (!sZoneDifficulty->MythicmodeEnable)
         return false;
 
-    if (sZoneDifficulty->MythicmodeLoot.find(mapId) == sZoneDifficulty->MythicmodeLoot.end())
-        return false;
-
-    return true;
+    return GetSnapshot().HasMapFlag(mapId, MAP_FLAG_MYTHIC);
 }
 
 /**
@@ -684,100 +1465,665 @@ bool ZoneDifficulty::VectorContainsUint32(std::vector<uint32> vec, uint32 elemen
  * @brief Checks if the instance and spelloverride have matching modes
  *
  * @param instanceId
- * @param spellId
- * @param mapId
+ * @param data The override found in the SpellOverrideIndex
  * @return The result as bool
  */
- bool ZoneDifficulty::OverrideModeMatches(uint32 instanceId, uint32 spellId, uint32 mapId)
+bool ZoneDifficulty::OverrideModeMatches(uint32 instanceId, ZoneDifficulySpellOverrideData const& data) const
 {
-    if ((sZoneDifficulty->HasMythicmode(sZoneDifficulty->SpellNerfOverrides[spellId][mapId].ModeMask) && sZoneDifficulty->MythicmodeInstanceData[instanceId]) ||
-        (sZoneDifficulty->HasNormalMode(sZoneDifficulty->SpellNerfOverrides[spellId][mapId].ModeMask) && !sZoneDifficulty->MythicmodeInstanceData[instanceId]))
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    bool isMythic = IsMythicmodeInstance(instanceId);
+    return (HasMythicmode(data.ModeMask) && isMythic) || (HasNormalMode(data.ModeMask) && !isMythic);
 }
 
 /**
- *  @brief Checks if the target is in a duel while residing in the DUEL_AREA and their opponent is a valid object.
- *  Used to determine when the duel-specific nerfs should be applied.
- *
- * @param target The affected <Unit>
- * @return The result as bool
+ *  @brief Compile the spell overrides into the spell bitset and the open addressing table.
+ *  The table is kept at a load factor of at most 50%.
  */
-bool ZoneDifficulty::ShouldNerfInDuels(Unit* target)
+void ZoneDifficultySpellOverrideIndex::Build(std::map<uint32, std::map<uint32, ZoneDifficulySpellOverrideData> > const& overrides)
 {
-    if (target->GetAreaId() != DUEL_AREA)
+    _spellBits.clear();
+    _slots.clear();
+    _shift = 64;
+
+    uint32 count = 0;
+    uint32 maxSpellId = 0;
+    for (auto const& [spellId, maps] : overrides)
+    {
+        count += maps.size();
+        maxSpellId = std::max(maxSpellId, spellId);
+    }
+
+    if (!count)
+        return;
+
+    uint8 bits = 1;
+    while ((uint64(1) << bits) < uint64(count) * 2)
+        ++bits;
+
+    _shift = 64 - bits;
+    _slots.resize(size_t(1) << bits);
+    _spellBits.resize((maxSpellId >> 6) + 1, 0);
+
+    for (auto const& [spellId, maps] : overrides)
+    {
+        if (!spellId)
+            continue;
+
+        _spellBits[spellId >> 6] |= uint64(1) << (spellId & 63);
+
+        for (auto const& [mapId, data] : maps)
+        {
+            uint64 key = MakeKey(spellId, mapId);
+            uint64 mask = _slots.size() - 1;
+            for (uint64 i = SlotFor(key); ; i = (i + 1) & mask)
+            {
+                if (!_slots[i].Key)
+                {
+                    _slots[i].Key = key;
+                    _slots[i].Data = data;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  @brief Find the override for the spell on the given map. Use mapId 0 for overrides on all maps.
+ *
+ * @return The override or nullptr if there is none.
+ */
+ZoneDifficulySpellOverrideData const* ZoneDifficultySpellOverrideIndex::Find(uint32 spellId, uint32 mapId) const
+{
+    if (!HasSpell(spellId))
+        return nullptr;
+
+    uint64 key = MakeKey(spellId, mapId);
+    uint64 mask = _slots.size() - 1;
+    for (uint64 i = SlotFor(key); _slots[i].Key; i = (i + 1) & mask)
+        if (_slots[i].Key == key)
+            return &_slots[i].Data;
+
+    return nullptr;
+}
+
+/**
+ *  @brief Checks if the target is in a duel while residing in the DUEL_AREA and their opponent is a valid object.
+ *  Used to determine when the duel-specific nerfs should be applied.
+ *
+ * @param target The affected <Unit>
+ * @return The result as bool
+ */
+bool ZoneDifficulty::ShouldNerfInDuels(Unit* target)
+{
+    if (target->GetAreaId() != DUEL_AREA)
         return false;
 
     if (target->ToTempSummon() && target->ToTempSummon()->GetSummoner())
         target = target->ToTempSummon()->GetSummoner()->ToUnit();
 
-    if (!target->GetAffectingPlayer())
-        return false;
+    if (!target->GetAffectingPlayer())
+        return false;
+
+    if (!target->GetAffectingPlayer()->duel)
+        return false;
+
+    if (target->GetAffectingPlayer()->duel->State != DUEL_STATE_IN_PROGRESS)
+        return false;
+
+    if (!target->GetAffectingPlayer()->duel->Opponent)
+        return false;
+
+    return true;
+}
+
+/**
+ *  @brief Find the lowest phase for the target's mapId, which has a db entry for the target's map
+ *  and at least partly matches the target's phase.
+ *
+ *  `mapId` can be the id of a map or `DUEL_INDEX` to use the duel specific settings.
+ *  Return -1 if none found.
+ *
+ * @param mapId
+ * @param phaseMask Bitmask of all phases where the unit is currently visible
+ * @return the lowest phase which should be altered for this map and the unit is visible in
+ */
+int32 ZoneDifficultySnapshot::GetLowestMatchingPhase(uint32 mapId, uint32 phaseMask) const
+{
+    // Check if there is an entry for the mapId at all
+    if (!ShouldNerfMap(mapId))
+        return -1;
+
+    ZoneDifficultyNerfMapEntry const& entry = NerfMaps[mapId];
+    int32 slot = GetLowestMatchingPhaseSlot(entry, phaseMask);
+    if (slot == -1)
+        return -1;
+
+    return NerfPhaseKeys[entry.FirstSlot + slot];
+}
+
+/**
+ *  @brief Find the slot of the lowest phase in the flattened table which matches the phaseMask.
+ *  Same rules as GetLowestMatchingPhase.
+ *
+ * @param entry The NerfMaps entry of the map
+ * @param phaseMask Bitmask of all phases where the unit is currently visible
+ * @return the slot relative to entry.FirstSlot or -1 if none found
+ */
+int32 ZoneDifficultySnapshot::GetLowestMatchingPhaseSlot(ZoneDifficultyNerfMapEntry const& entry, uint32 phaseMask) const
+{
+    if (!entry.PhaseCount)
+        return -1;
+
+    // Keys are ascending, so phase 0 (all phases) is always the first slot
+    if (entry.AllPhases)
+        return 0;
+
+    // Units are almost always visible in a single phase, so this is one read per set bit
+    uint32 const* bitSlots = &NerfPhaseBitSlots[entry.PhaseBitOffset];
+    uint32 slots = 0;
+    for (uint32 bits = phaseMask; bits; bits &= bits - 1)
+        slots |= bitSlots[std::countr_zero(bits)];
+
+    if (!slots)
+        return -1;
+
+    return std::countr_zero(slots);
+}
+
+/**
+ *  @brief Resolve the multipliers for the target's map, phase and instance mode.
+ *
+ * @param target The affected <Unit>
+ * @return The multipliers to apply or nullptr if the map is not tuned for the target's phase.
+ */
+ZoneDifficultyNerfMultipliers const* ZoneDifficulty::GetNerfMultipliers(Unit* target) const
+{
+    ZoneDifficultySnapshot const& snapshot = GetSnapshot();
+    uint32 mapId = target->GetMapId();
+    if (mapId >= snapshot.NerfMaps.size())
+        return nullptr;
+
+    ZoneDifficultyNerfMapEntry const& entry = snapshot.NerfMaps[mapId];
+    int32 slot = snapshot.GetLowestMatchingPhaseSlot(entry, target->GetPhaseMask());
+    if (slot == -1)
+        return nullptr;
+
+    Map* map = target->GetMap();
+    uint8 mode = NERF_MODE_INDEX_NORMAL;
+    if (IsMythicmodeInstance(map->GetInstanceId()))
+    {
+        // Mythic values only apply to raids and heroic dungeons
+        if (!map->IsRaid() && !(map->IsHeroic() && map->IsDungeon()))
+            return &NoNerf;
+
+        mode = NERF_MODE_INDEX_MYTHIC;
+    }
+
+    return &snapshot.NerfTable[(entry.FirstSlot + slot) * NERF_MODE_INDEX_MAX + mode];
+}
+
+ZoneDifficultyInstanceStore::~ZoneDifficultyInstanceStore()
+{
+    for (std::atomic<Page*>& page : _pages)
+        delete page.load(std::memory_order_relaxed);
+}
+
+/**
+ *  @brief Get the state of an instance without allocating anything. Returns nullptr if nothing was ever stored for it.
+ */
+ZoneDifficultyInstanceState const* ZoneDifficultyInstanceStore::Find(uint32 instanceId) const
+{
+    uint32 pageIndex = instanceId >> PAGE_BITS;
+    if (pageIndex >= MAX_PAGES)
+        return nullptr;
+
+    Page const* page = _pages[pageIndex].load(std::memory_order_acquire);
+    if (!page)
+        return nullptr;
+
+    return &page->States[instanceId & (PAGE_SIZE - 1)];
+}
+
+ZoneDifficultyInstanceState* ZoneDifficultyInstanceStore::GetOrCreate(uint32 instanceId)
+{
+    uint32 pageIndex = instanceId >> PAGE_BITS;
+    if (pageIndex >= MAX_PAGES)
+    {
+        LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Instance id {} exceeds the instance state table ({} ids). State is not stored.", instanceId, MAX_PAGES * PAGE_SIZE);
+        return nullptr;
+    }
+
+    Page* page = _pages[pageIndex].load(std::memory_order_acquire);
+    if (!page)
+    {
+        std::lock_guard<std::mutex> guard(_shardLocks[pageIndex % SHARD_COUNT]);
+        page = _pages[pageIndex].load(std::memory_order_relaxed);
+        if (!page)
+        {
+            page = new Page();
+            _pages[pageIndex].store(page, std::memory_order_release);
+        }
+    }
+
+    return &page->States[instanceId & (PAGE_SIZE - 1)];
+}
+
+bool ZoneDifficultyInstanceStore::IsMythicmode(uint32 instanceId) const
+{
+    ZoneDifficultyInstanceState const* state = Find(instanceId);
+    return state && state->MythicmodeOn.load(std::memory_order_relaxed);
+}
+
+void ZoneDifficultyInstanceStore::SetMythicmode(uint32 instanceId, bool on)
+{
+    if (ZoneDifficultyInstanceState* state = GetOrCreate(instanceId))
+        state->MythicmodeOn.store(on, std::memory_order_relaxed);
+}
+
+uint32 ZoneDifficultyInstanceStore::GetEncounterStartTime(uint32 instanceId) const
+{
+    ZoneDifficultyInstanceState const* state = Find(instanceId);
+    return state ? state->EncounterStartTime.load(std::memory_order_relaxed) : 0;
+}
+
+void ZoneDifficultyInstanceStore::SetEncounterStartTime(uint32 instanceId, uint32 startTime)
+{
+    if (ZoneDifficultyInstanceState* state = GetOrCreate(instanceId))
+        state->EncounterStartTime.store(startTime, std::memory_order_relaxed);
+}
+
+void ZoneDifficultyInstanceStore::QueueRescale(uint32 instanceId)
+{
+    if (ZoneDifficultyInstanceState* state = GetOrCreate(instanceId))
+        state->RescalePending.store(true, std::memory_order_release);
+}
+
+/**
+ *  @brief Consume a queued rescale. Returns true only for the first caller after QueueRescale.
+ */
+bool ZoneDifficultyInstanceStore::TakeRescale(uint32 instanceId)
+{
+    uint32 pageIndex = instanceId >> PAGE_BITS;
+    if (pageIndex >= MAX_PAGES)
+        return false;
+
+    Page* page = _pages[pageIndex].load(std::memory_order_acquire);
+    if (!page)
+        return false;
+
+    std::atomic<bool>& pending = page->States[instanceId & (PAGE_SIZE - 1)].RescalePending;
+    return pending.load(std::memory_order_relaxed) && pending.exchange(false, std::memory_order_acq_rel);
+}
+
+/**
+ *  @brief Forget everything about an instance, its id may be handed out again.
+ */
+void ZoneDifficultyInstanceStore::Reset(uint32 instanceId)
+{
+    uint32 pageIndex = instanceId >> PAGE_BITS;
+    if (pageIndex >= MAX_PAGES)
+        return;
+
+    if (Page* page = _pages[pageIndex].load(std::memory_order_acquire))
+    {
+        ZoneDifficultyInstanceState& state = page->States[instanceId & (PAGE_SIZE - 1)];
+        state.MythicmodeOn.store(false, std::memory_order_relaxed);
+        state.EncounterStartTime.store(0, std::memory_order_relaxed);
+        state.RescalePending.store(false, std::memory_order_relaxed);
+        state.AbilityWheel.reset();
+    }
+}
+
+/**
+ *  @brief Drop the pending Mythicmode AI abilities of an instance, once its map is unloaded.
+ */
+void ZoneDifficultyInstanceStore::ReleaseAbilityWheel(uint32 instanceId)
+{
+    uint32 pageIndex = instanceId >> PAGE_BITS;
+    if (pageIndex >= MAX_PAGES)
+        return;
+
+    if (Page* page = _pages[pageIndex].load(std::memory_order_acquire))
+        page->States[instanceId & (PAGE_SIZE - 1)].AbilityWheel.reset();
+}
+
+void ZoneDifficultyInstanceSaves::QueueSave(uint32 instanceId)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    Queue(_saves, _deletes, instanceId);
+}
+
+void ZoneDifficultyInstanceSaves::QueueDelete(uint32 instanceId)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    Queue(_deletes, _saves, instanceId);
+}
+
+// An instance is either saved or deleted, whatever happened last wins
+void ZoneDifficultyInstanceSaves::Queue(std::set<uint32>& add, std::set<uint32>& remove, uint32 instanceId)
+{
+    if (!_pending)
+    {
+        _oldestQueuedTime = getMSTime();
+        _pending = true;
+    }
+
+    remove.erase(instanceId);
+    add.insert(instanceId);
+}
+
+void ZoneDifficultyInstanceSaves::Update()
+{
+    if (!_pending)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (GetMSTimeDiffToNow(_oldestQueuedTime) < uint32(FlushInterval.count()))
+            return;
+    }
+
+    Flush();
+}
+
+/**
+ *  @brief Write the flags of the dirty instances and delete the expired ones in one transaction.
+ *  The flag is read at flush time, so only the latest state of an instance is written.
+ */
+void ZoneDifficultyInstanceSaves::Flush()
+{
+    std::set<uint32> saves;
+    std::set<uint32> deletes;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_pending)
+            return;
+
+        saves.swap(_saves);
+        deletes.swap(_deletes);
+        _pending = false;
+    }
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+
+    auto itr = saves.begin();
+    while (itr != saves.end())
+    {
+        std::string sql = "REPLACE INTO zone_difficulty_instance_saves (InstanceID, MythicmodeOn) VALUES ";
+        for (std::size_t i = 0; i < ROWS_PER_STATEMENT && itr != saves.end(); ++i, ++itr)
+            sql += Acore::StringFormat("{}({}, {})", i ? ", " : "", *itr, sZoneDifficulty->IsMythicmodeInstance(*itr));
+
+        trans->Append(sql.c_str());
+    }
+
+    AppendDeletes(trans, deletes);
+    CharacterDatabase.CommitTransaction(trans);
+}
+
+void ZoneDifficultyInstanceSaves::Flush(uint32 instanceId)
+{
+    bool save;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        save = _saves.erase(instanceId);
+        if (!save && !_deletes.erase(instanceId))
+            return;
+
+        if (_saves.empty() && _deletes.empty())
+            _pending = false;
+    }
+
+    if (save)
+        CharacterDatabase.Execute("REPLACE INTO zone_difficulty_instance_saves (InstanceID, MythicmodeOn) VALUES ({}, {})", instanceId, sZoneDifficulty->IsMythicmodeInstance(instanceId));
+    else
+        CharacterDatabase.Execute("DELETE FROM zone_difficulty_instance_saves WHERE InstanceID = {}", instanceId);
+}
+
+/**
+ *  @brief Delete the rows of the given instances right away, in one transaction.
+ */
+void ZoneDifficultyInstanceSaves::Delete(std::set<uint32> const& instanceIds)
+{
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+    AppendDeletes(trans, instanceIds);
+    CharacterDatabase.CommitTransaction(trans);
+}
+
+void ZoneDifficultyInstanceSaves::AppendDeletes(CharacterDatabaseTransaction trans, std::set<uint32> const& instanceIds)
+{
+    auto itr = instanceIds.begin();
+    while (itr != instanceIds.end())
+    {
+        std::string sql = "DELETE FROM zone_difficulty_instance_saves WHERE InstanceID IN (";
+        for (std::size_t i = 0; i < ROWS_PER_STATEMENT && itr != instanceIds.end(); ++i, ++itr)
+            sql += Acore::StringFormat("{}{}", i ? ", " : "", *itr);
+
+        sql += ")";
+        trans->Append(sql.c_str());
+    }
+}
+
+void ZoneDifficultyLogWriter::QueueEncounterLogs(std::vector<ZoneDifficultyEncounterLog> const& rows)
+{
+    if (rows.empty())
+        return;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_pending.exchange(true))
+        _oldestQueuedTime = getMSTime();
+
+    _encounterLogs.insert(_encounterLogs.end(), rows.begin(), rows.end());
+}
+
+void ZoneDifficultyLogWriter::QueueCompletionLogs(std::vector<ZoneDifficultyCompletionLog> const& rows)
+{
+    if (rows.empty())
+        return;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_pending.exchange(true))
+        _oldestQueuedTime = getMSTime();
+
+    _completionLogs.insert(_completionLogs.end(), rows.begin(), rows.end());
+}
+
+std::vector<ZoneDifficultyEncounterLog> ZoneDifficultyLogWriter::GetQueuedEncounterLogs(uint32 playerGuid)
+{
+    std::vector<ZoneDifficultyEncounterLog> logs;
+    std::lock_guard<std::mutex> guard(_lock);
+    for (ZoneDifficultyEncounterLog const& row : _encounterLogs)
+        if (row.PlayerGuid == playerGuid)
+            logs.push_back(row);
+
+    return logs;
+}
+
+void ZoneDifficultyLogWriter::Update()
+{
+    if (!_pending.load(std::memory_order_relaxed))
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (GetMSTimeDiffToNow(_oldestQueuedTime) < uint32(FlushInterval.count()))
+            return;
+    }
+
+    Flush();
+}
+
+/**
+ *  @brief Write everything queued in one transaction, ROWS_PER_STATEMENT rows per statement.
+ */
+void ZoneDifficultyLogWriter::Flush()
+{
+    std::vector<ZoneDifficultyEncounterLog> encounterLogs;
+    std::vector<ZoneDifficultyCompletionLog> completionLogs;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_pending)
+            return;
+
+        encounterLogs.swap(_encounterLogs);
+        completionLogs.swap(_completionLogs);
+        _pending = false;
+    }
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+
+    for (std::size_t first = 0; first < encounterLogs.size(); first += ROWS_PER_STATEMENT)
+    {
+        std::string sql = "REPLACE INTO `zone_difficulty_encounter_logs` (`InstanceId`, `TimestampStart`, `TimestampEnd`, `Map`, `BossId`, `PlayerGuid`, `Mode`) VALUES ";
+        std::size_t last = std::min(first + ROWS_PER_STATEMENT, encounterLogs.size());
+        for (std::size_t i = first; i < last; ++i)
+        {
+            ZoneDifficultyEncounterLog const& row = encounterLogs[i];
+            sql += Acore::StringFormat("{}({}, {}, {}, {}, {}, {}, {})", i == first ? "" : ", ", row.InstanceId, row.TimestampStart, row.TimestampEnd, row.Map, row.BossId, row.PlayerGuid, row.Mode);
+        }
+        trans->Append(sql.c_str());
+    }
+
+    // IGNORE keeps a single duplicate from failing the whole statement, the rows used to be inserted one by one
+    for (std::size_t first = 0; first < completionLogs.size(); first += ROWS_PER_STATEMENT)
+    {
+        std::string sql = "INSERT IGNORE INTO zone_difficulty_completion_logs (guid, type, mode) VALUES ";
+        std::size_t last = std::min(first + ROWS_PER_STATEMENT, completionLogs.size());
+        for (std::size_t i = first; i < last; ++i)
+        {
+            ZoneDifficultyCompletionLog const& row = completionLogs[i];
+            sql += Acore::StringFormat("{}({}, {}, {})", i == first ? "" : ", ", row.Guid, row.Type, row.Mode);
+        }
+        trans->Append(sql.c_str());
+    }
+
+    CharacterDatabase.CommitTransaction(trans);
+}
+
+/**
+ *  @brief Start loading the Mythicmode kills of a player who logged in.
+ *  Kills still queued in the LogWriter are not in the table yet, they are taken over right away.
+ */
+void ZoneDifficultyProgressCache::Load(uint32 playerGuid)
+{
+    std::vector<ZoneDifficultyEncounterLog> queued = sZoneDifficulty->LogWriter.GetQueuedEncounterLogs(playerGuid);
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        MergeQueued(_players[playerGuid], queued);
+    }
+
+    _queries.AddCallback(CharacterDatabase.AsyncQuery(Acore::StringFormat("SELECT `Map`, `BossId` FROM zone_difficulty_encounter_logs WHERE `Mode` = 64 AND `PlayerGuid` = {}", playerGuid))
+        .WithCallback([this, playerGuid](QueryResult result)
+        {
+            Apply(playerGuid, std::move(result));
+        }));
+}
+
+void ZoneDifficultyProgressCache::Evict(uint32 playerGuid)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _players.erase(playerGuid);
+}
+
+/**
+ *  @brief Add a kill of a player who is online. Kills of offline players are only in the database.
+ */
+void ZoneDifficultyProgressCache::MarkKilled(uint32 playerGuid, uint32 mapId, uint32 bossId)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    auto itr = _players.find(playerGuid);
+    if (itr != _players.end())
+        SetKilled(itr->second, mapId, bossId);
+}
+
+/**
+ *  @brief Check if the player has killed all bosses set in the required masks in Mythicmode.
+ *  If the query started on login did not finish yet, the kills are loaded synchronously.
+ */
+bool ZoneDifficultyProgressCache::HasKilledAll(uint32 playerGuid, ZoneDifficultyProgressMasks const& required)
+{
+    auto hasKilledAll = [&required](Progress const& progress)
+    {
+        for (uint8 slot = 0; slot < MYTHIC_PROGRESS_SLOTS; ++slot)
+            if ((progress.Killed[slot] & required[slot]) != required[slot])
+                return false;
+
+        return true;
+    };
 
-    if (!target->GetAffectingPlayer()->duel)
-        return false;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        auto itr = _players.find(playerGuid);
+        if (itr != _players.end() && itr->second.Loaded)
+            return hasKilledAll(itr->second);
+    }
 
-    if (target->GetAffectingPlayer()->duel->State != DUEL_STATE_IN_PROGRESS)
-        return false;
+    QueryResult result = CharacterDatabase.Query("SELECT `Map`, `BossId` FROM zone_difficulty_encounter_logs WHERE `Mode` = 64 AND `PlayerGuid` = {}", playerGuid);
+    std::vector<ZoneDifficultyEncounterLog> queued = sZoneDifficulty->LogWriter.GetQueuedEncounterLogs(playerGuid);
 
-    if (!target->GetAffectingPlayer()->duel->Opponent)
-        return false;
+    std::lock_guard<std::mutex> guard(_lock);
+    Progress& progress = _players[playerGuid];
+    MergeQueued(progress, queued);
+    Merge(progress, result);
+    return hasKilledAll(progress);
+}
 
-    return true;
+void ZoneDifficultyProgressCache::Update()
+{
+    _queries.ProcessReadyCallbacks();
 }
 
 /**
- *  @brief Find the lowest phase for the target's mapId, which has a db entry for the target's map
- *  and at least partly matches the target's phase.
- *
- *  `mapId` can be the id of a map or `DUEL_INDEX` to use the duel specific settings.
- *  Return -1 if none found.
- *
- * @param mapId
- * @param phaseMask Bitmask of all phases where the unit is currently visible
- * @return the lowest phase which should be altered for this map and the unit is visible in
+ *  @brief Add loaded kills to the cache. Kills made meanwhile are kept, nothing is added for players who logged out.
  */
-int32 ZoneDifficulty::GetLowestMatchingPhase(uint32 mapId, uint32 phaseMask)
+void ZoneDifficultyProgressCache::Apply(uint32 playerGuid, QueryResult result)
 {
-    // Check if there is an entry for the mapId at all
-    if (sZoneDifficulty->ShouldNerfMap(mapId))
-    {
-
-        // Check if 0 is assigned as a phase to cover all phases
-        if (sZoneDifficulty->NerfInfo[mapId].find(0) != sZoneDifficulty->NerfInfo[mapId].end())
-        {
-            return 0;
-        }
+    std::lock_guard<std::mutex> guard(_lock);
+    auto itr = _players.find(playerGuid);
+    if (itr != _players.end())
+        Merge(itr->second, result);
+}
 
-        for (auto const& [key, value] : sZoneDifficulty->NerfInfo[mapId])
+void ZoneDifficultyProgressCache::Merge(Progress& progress, QueryResult const& result)
+{
+    if (result)
+    {
+        do
         {
-            if (key & phaseMask)
-            {
-                return key;
-            }
-        }
+            SetKilled(progress, (*result)[0].Get<uint32>(), (*result)[1].Get<uint32>());
+        } while (result->NextRow());
     }
-    return -1;
+
+    progress.Loaded = true;
+}
+
+void ZoneDifficultyProgressCache::MergeQueued(Progress& progress, std::vector<ZoneDifficultyEncounterLog> const& logs)
+{
+    for (ZoneDifficultyEncounterLog const& row : logs)
+        if (row.Mode == MODE_HARD)
+            SetKilled(progress, row.Map, row.BossId);
+}
+
+void ZoneDifficultyProgressCache::SetKilled(Progress& progress, uint32 mapId, uint32 bossId)
+{
+    int32 slot = GetSlot(mapId);
+    if (slot >= 0 && bossId < 64)
+        progress.Killed[slot] |= uint64(1) << bossId;
+}
+
+int32 ZoneDifficultyProgressCache::GetSlot(uint32 mapId)
+{
+    return mapId < TierSlots.size() ? TierSlots[mapId] : -1;
 }
 
 /**
- *  @brief Store the MythicmodeInstanceData in the database for the given instance id.
- *  zone_difficulty_instance_saves is used to store the data.
+ *  @brief Store the mythic flag of the given instance in the database.
+ *  zone_difficulty_instance_saves is used to store the data, written with the next flush of InstanceSaves.
  *
  *  @param InstanceID INT NOT NULL DEFAULT 0,
  */
 void ZoneDifficulty::SaveMythicmodeInstanceData(uint32 instanceId)
 {
-    if (sZoneDifficulty->MythicmodeInstanceData.find(instanceId) == sZoneDifficulty->MythicmodeInstanceData.end())
-    {
-        return;
-    }
-    CharacterDatabase.Execute("REPLACE INTO zone_difficulty_instance_saves (InstanceID, MythicmodeOn) VALUES ({}, {})", instanceId, sZoneDifficulty->MythicmodeInstanceData[instanceId]);
+    InstanceSaves.QueueSave(instanceId);
 }
 
 void ZoneDifficulty::MythicmodeEvent(Unit* unit, uint32 entry, uint32 key)
@@ -786,195 +2132,257 @@ void ZoneDifficulty::MythicmodeEvent(Unit* unit, uint32 entry, uint32 key)
     {
         if (!unit->IsInCombat())
         {
-            unit->m_Events.CancelEventGroup(EVENT_GROUP);
+            CancelMythicAbilities(unit);
             return;
         }
 
-        // Try again in 1s if the unit is currently casting
+        // Wait until the current cast is finished or interrupted
         if (unit->HasUnitState(UNIT_STATE_CASTING))
         {
-            unit->m_Events.AddEventAtOffset([unit, entry, key]()
-                {
-                    sZoneDifficulty->MythicmodeEvent(unit, entry, key);
-                }, 1s, EVENT_GROUP);
+            ParkMythicAbility(unit, entry, key);
             return;
         }
 
-        if (sZoneDifficulty->MythicmodeAI[entry][key].Repetitions == 0)
-        {
-            unit->m_Events.AddEventAtOffset([unit, entry, key]()
-                {
-                    sZoneDifficulty->MythicmodeEvent(unit, entry, key);
-                }, sZoneDifficulty->MythicmodeAI[entry][key].Cooldown, EVENT_GROUP);
-        }
+        // The AI rows may have changed with a reload since the event was scheduled
+        ZoneDifficultyHAI const* mythicAI = sZoneDifficulty->GetSnapshot().GetMythicAbility(entry, key);
+        if (!mythicAI)
+            return;
 
-        ZoneDifficultyHAI mythicAI = sZoneDifficulty->MythicmodeAI[entry][key];
-        bool has_bp0 = mythicAI.Spellbp0;
-        bool has_bp1 = mythicAI.Spellbp1;
-        bool has_bp2 = mythicAI.Spellbp2;
+        if (mythicAI->Flags & MYTHIC_ABILITY_FLAG_REPEAT)
+            ScheduleMythicAbility(unit, entry, key, mythicAI->Cooldown);
 
-        if (mythicAI.Target == TARGET_PLAYER_DISTANCE)
+        if (mythicAI->Target == TARGET_PLAYER_DISTANCE)
         {
-            auto const& threatlist = unit->GetThreatMgr().GetThreatList();
+            // Same check as IsWithinDist, over the whole threat list at once
+            ThreatTargetCache& threat = GatherThreatTargets(unit);
+            threat.Targets.FilterWithin(unit->GetPositionX(), unit->GetPositionY(), unit->GetPositionZ(), mythicAI->SelectRange + unit->GetObjectSize(), threat.Candidates);
+
+            for (uint16 index : threat.Candidates)
+                CastMythicAbility(unit, threat.Targets[index], *mythicAI);
+
+            for (Unit* target : threat.Overflow)
+                if (unit->IsWithinDist(target, mythicAI->SelectRange))
+                    CastMythicAbility(unit, target, *mythicAI);
 
-            for (auto itr = threatlist.begin(); itr != threatlist.end(); ++itr)
-            {
-                Unit* target = (*itr)->getTarget();
-                if (!unit->IsWithinDist(target, mythicAI.TargetArg))
-                    continue;
-
-                std::string targetName = target ? target->GetName() : "NoTarget";
-                if (!has_bp0 && !has_bp1 && !has_bp2)
-                    unit->CastSpell(target, mythicAI.Spell, mythicAI.TriggeredCast);
-                else
-                {
-                    unit->CastCustomSpell(target, mythicAI.Spell,
-                        has_bp0 ? &mythicAI.Spellbp0 : NULL,
-                        has_bp1 ? &mythicAI.Spellbp1 : NULL,
-                        has_bp2 ? &mythicAI.Spellbp2 : NULL,
-                        mythicAI.TriggeredCast);
-                }
-            }
             return;
         }
 
         // Select target
         Unit* target = nullptr;
-        if (mythicAI.Target == TARGET_SELF)
-            target = unit;
-        else if (mythicAI.Target == TARGET_VICTIM)
-            target = unit->GetVictim();
+        switch (mythicAI->Target)
+        {
+            case TARGET_SELF:
+                target = unit;
+                break;
+            case TARGET_VICTIM:
+                target = unit->GetVictim();
+                break;
+            case TARGET_HOSTILE_AGGRO_FROM_TOP:
+                target = unit->GetAI()->SelectTarget(SelectTargetMethod::MaxThreat, mythicAI->ThreatPosition, mythicAI->SelectRange, true);
+                if (!target)
+                    target = unit->GetVictim();
+                break;
+            case TARGET_HOSTILE_AGGRO_FROM_BOTTOM:
+                target = unit->GetAI()->SelectTarget(SelectTargetMethod::MinThreat, mythicAI->ThreatPosition, mythicAI->SelectRange, true);
+                if (!target)
+                    target = unit->GetVictim();
+                break;
+            case TARGET_HOSTILE_RANDOM:
+                target = unit->GetAI()->SelectTarget(SelectTargetMethod::Random, 0, mythicAI->SelectRange, true);
+                break;
+            case TARGET_HOSTILE_RANDOM_NOT_TOP:
+                target = unit->GetAI()->SelectTarget(SelectTargetMethod::Random, 0, mythicAI->SelectRange, true, false);
+                break;
+            case TARGET_PLAYER_DENSEST_CLUSTER:
+            case TARGET_PLAYER_MOST_ALLIES:
+                target = SelectClusterTarget(unit, *mythicAI);
+                break;
+            default:
+                break;
+        }
+
+        if (!target && (mythicAI->Flags & MYTHIC_ABILITY_FLAG_FALLBACK))
+        {
+            Unit* victim = unit->GetVictim();
+            if (victim && unit->IsInRange(victim, mythicAI->MinRange, mythicAI->MaxRange, true))
+                target = victim;
+        }
+
+        if (target || mythicAI->Target == TARGET_NONE)
+            CastMythicAbility(unit, target, *mythicAI);
         else
         {
-            switch (mythicAI.Target)
-            {
-                case TARGET_HOSTILE_AGGRO_FROM_TOP:
-                {
-                    float range = 200.0f;
-                    if (mythicAI.TargetArg > 0)
-                        range = mythicAI.TargetArg;
+            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: No target could be found for unit with entry {} and harmodeAI key {}.", entry, key);
+        }
+    }
+}
 
-                    target = unit->GetAI()->SelectTarget(SelectTargetMethod::MaxThreat, mythicAI.TargetArg2, range, true);
+/**
+ *  @brief Queue a Mythicmode AI ability of the unit in the ability wheel of its instance.
+ */
+void ZoneDifficulty::ScheduleMythicAbility(Unit* unit, uint32 entry, uint32 index, Milliseconds delay)
+{
+    ZoneDifficultyInstanceState* state = InstanceStates.GetOrCreate(unit->GetInstanceId());
+    if (!state)
+        return;
 
-                    if (!target)
-                        target = unit->GetVictim();
+    uint64 now = GameTime::GetGameTimeMS().count();
+    if (!state->AbilityWheel)
+        state->AbilityWheel = std::make_unique<ZoneDifficultyAbilityWheel>(now);
 
-                    break;
-                }
-                case TARGET_HOSTILE_AGGRO_FROM_BOTTOM:
-                {
-                    float range = 200.0f;
-                    if (mythicAI.TargetArg2 > 0)
-                        range = mythicAI.TargetArg2;
+    ZoneDifficultyAbilityMarker* marker = unit->CustomData.GetDefault<ZoneDifficultyAbilityMarker>(AbilityMarkerKey);
+    if (marker->Slots.size() <= index)
+        marker->Slots.resize(index + 1);
 
-                    target = unit->GetAI()->SelectTarget(SelectTargetMethod::MinThreat, mythicAI.TargetArg, range, true);
+    ZoneDifficultyMythicAbility ability;
+    ability.UnitGuid = unit->GetGUID();
+    ability.Entry = entry;
+    ability.Index = index;
+    ability.Generation = marker->Generation;
+    ability.Priority = GetMythicAbilityPriority(entry, index);
 
-                    if (!target)
-                        target = unit->GetVictim();
+    // An ability is only queued once per unit, replace a pending one
+    state->AbilityWheel->Cancel(marker->Slots[index]);
+    marker->Slots[index] = state->AbilityWheel->Schedule(ability, now + delay.count());
+}
 
-                    break;
-                }
-                case TARGET_HOSTILE_RANDOM:
-                {
-                    target = unit->GetAI()->SelectTarget(SelectTargetMethod::Random, 0, mythicAI.TargetArg, true);
-                    break;
-                }
-                case TARGET_HOSTILE_RANDOM_NOT_TOP:
-                {
-                    target = unit->GetAI()->SelectTarget(SelectTargetMethod::Random, 0, mythicAI.TargetArg, true, false);
-                    break;
-                }
-                default:
-                {
-                    LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Unknown type for Target: {} in zone_difficulty_mythicmode_ai", mythicAI.Target);
-                }
-            }
-        }
+/**
+ *  @brief Remove all pending Mythicmode AI abilities of the unit from the ability wheel,
+ *  e.g. when it dies, evades or leaves the world.
+ */
+void ZoneDifficulty::CancelMythicAbilities(Unit* unit)
+{
+    ZoneDifficultyAbilityMarker* marker = unit->CustomData.Get<ZoneDifficultyAbilityMarker>(AbilityMarkerKey);
+    if (!marker)
+        return;
 
-        if (!target && mythicAI.Target != TARGET_NONE)
-        {
-            Unit* victim = nullptr;
-            if (mythicAI.TargetArg > 0)
-            {
-                if (unit->IsInRange(victim, 0, mythicAI.TargetArg, true))
-                    target = victim;
-            }
-            else if (mythicAI.TargetArg < 0)
-            {
-                if (unit->IsInRange(victim, mythicAI.TargetArg, 0, true))
-                    target = victim;
-            }
+    ++marker->Generation;
 
-        }
+    ZoneDifficultyInstanceState* state = InstanceStates.Find(unit->GetInstanceId());
+    if (state && state->AbilityWheel)
+        for (ZoneDifficultyAbilityWheel::Handle handle : marker->Slots)
+            state->AbilityWheel->Cancel(handle);
 
-        if (target || mythicAI.Target == TARGET_NONE)
-        {
-            std::string targetName = target ? target->GetName() : "NoTarget";
+    std::fill(marker->Slots.begin(), marker->Slots.end(), ZoneDifficultyAbilityWheel::Handle());
+    marker->Parked.clear();
+}
 
-            if (!has_bp0 && !has_bp1 && !has_bp2)
-            {
-                unit->CastSpell(target, mythicAI.Spell, mythicAI.TriggeredCast);
-            }
-            else
-            {
-                unit->CastCustomSpell(target, mythicAI.Spell,
-                    has_bp0 ? &mythicAI.Spellbp0 : NULL,
-                    has_bp1 ? &mythicAI.Spellbp1 : NULL,
-                    has_bp2 ? &mythicAI.Spellbp2 : NULL,
-                    mythicAI.TriggeredCast);
-            }
+/**
+ *  @brief Hold back a due ability of a casting unit. It is released on the first map update
+ *  after the cast finished or was interrupted, together with all other abilities parked meanwhile.
+ */
+void ZoneDifficulty::ParkMythicAbility(Unit* unit, uint32 entry, uint32 index)
+{
+    ZoneDifficultyInstanceState* state = InstanceStates.GetOrCreate(unit->GetInstanceId());
+    if (!state)
+        return;
+
+    ZoneDifficultyAbilityMarker* marker = unit->CustomData.GetDefault<ZoneDifficultyAbilityMarker>(AbilityMarkerKey);
+    for (ZoneDifficultyMythicAbility const& parked : marker->Parked)
+        if (parked.Entry == entry && parked.Index == index)
+            return;
+
+    if (marker->Parked.empty())
+        state->ParkedUnits.push_back(unit->GetGUID());
+
+    ZoneDifficultyMythicAbility ability;
+    ability.UnitGuid = unit->GetGUID();
+    ability.Entry = entry;
+    ability.Index = index;
+    ability.Generation = marker->Generation;
+    ability.Priority = GetMythicAbilityPriority(entry, index);
+    marker->Parked.push_back(ability);
+}
+
+/**
+ *  @brief Fire all Mythicmode AI abilities of the instance which became due. Called from the update of the map itself.
+ */
+void ZoneDifficulty::UpdateMythicAbilities(Map* map)
+{
+    ZoneDifficultyInstanceState* state = InstanceStates.Find(map->GetInstanceId());
+    if (!state)
+        return;
+
+    std::vector<ZoneDifficultyMythicAbility>& due = state->DueAbilities;
+    ++MythicUpdateSerial;
+
+    // Release the abilities of units which stopped casting
+    for (std::size_t i = 0; i < state->ParkedUnits.size();)
+    {
+        Creature* creature = map->GetCreature(state->ParkedUnits[i]);
+        ZoneDifficultyAbilityMarker* marker = creature ? creature->CustomData.Get<ZoneDifficultyAbilityMarker>(AbilityMarkerKey) : nullptr;
+        if (marker && !marker->Parked.empty() && creature->HasUnitState(UNIT_STATE_CASTING))
+        {
+            ++i;
+            continue;
         }
-        else
+
+        state->ParkedUnits[i] = state->ParkedUnits.back();
+        state->ParkedUnits.pop_back();
+
+        if (marker)
         {
-            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: No target could be found for unit with entry {} and harmodeAI key {}.", entry, key);
+            due.assign(marker->Parked.begin(), marker->Parked.end());
+            marker->Parked.clear();
+            FireMythicAbilities(map, due);
         }
     }
+
+    if (!state->AbilityWheel)
+        return;
+
+    due.clear();
+    state->AbilityWheel->Advance(GameTime::GetGameTimeMS().count(), [&due](ZoneDifficultyMythicAbility const& ability)
+    {
+        due.push_back(ability);
+    });
+
+    FireMythicAbilities(map, due);
+}
+
+/**
+ *  @brief Run a batch of due abilities unit by unit, each unit's highest Priority first, then in row order.
+ *  Keeping the abilities of a unit together lets them share its threat list snapshot.
+ */
+void ZoneDifficulty::FireMythicAbilities(Map* map, std::vector<ZoneDifficultyMythicAbility>& abilities)
+{
+    std::sort(abilities.begin(), abilities.end(), [](ZoneDifficultyMythicAbility const& left, ZoneDifficultyMythicAbility const& right)
+    {
+        if (left.UnitGuid != right.UnitGuid)
+            return left.UnitGuid < right.UnitGuid;
+
+        if (left.Priority != right.Priority)
+            return left.Priority > right.Priority;
+
+        return left.Index < right.Index;
+    });
+
+    for (ZoneDifficultyMythicAbility const& ability : abilities)
+    {
+        // Resolve the handle, the unit may be gone or may have been reset since the ability was queued
+        Creature* creature = map->GetCreature(ability.UnitGuid);
+        if (!creature)
+            continue;
+
+        ZoneDifficultyAbilityMarker* marker = creature->CustomData.Get<ZoneDifficultyAbilityMarker>(AbilityMarkerKey);
+        if (!marker || marker->Generation != ability.Generation)
+            continue;
+
+        MythicmodeEvent(creature, ability.Entry, ability.Index);
+    }
 }
 
 bool ZoneDifficulty::HasCompletedFullTier(uint32 category, uint32 playerGuid)
 {
-    std::vector<uint32> MapList;
-    switch (category)
+    ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+    auto required = snapshot.TierRequirements.find(category);
+    if (required == snapshot.TierRequirements.end())
     {
-    case TYPE_HEROIC_TBC:
-        //585 is Magister's Terrace. Only add when released.
-        MapList = { 269, 540, 542, 543, 545, 547, 546, 552, 553, 554, 555, 556, 557, 558, 560/*, 585*/ };
-        break;
-    case TYPE_RAID_T4:
-        MapList = { 532, 544, 565};
-        break;
-    case TYPE_RAID_T6:
-        MapList = { 564 };
-        break;
-    case TYPE_RAID_ZA:
-        MapList = { 568 };
-        break;
-    case TYPE_RAID_SSC:
-        MapList = { 548 };
-        break;
-    case TYPE_RAID_HYJAL:
-        MapList = { 534 };
-        break;
-    default:
         LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Category without data requested in ZoneDifficulty::HasCompletedFullTier {}", category);
         return false;
-        break;
     }
 
-    for (uint32 mapId : MapList)
-    {
-        if (sZoneDifficulty->EncounterCounter.find(mapId) == sZoneDifficulty->EncounterCounter.end())
-        {
-            LOG_ERROR("module", "MOD-ZONE-DIFFICULTY: Map without data requested in ZoneDifficulty::HasCompletedFullTier {}", mapId);
-            return false;
-        }
-        for (uint8 i = 0; i < sZoneDifficulty->EncounterCounter[mapId]; ++i)
-        {
-            if (!sZoneDifficulty->Logs[playerGuid][mapId][i])
-                return false;
-        }
-    }
-    return true;
+    return sZoneDifficulty->Progress.HasKilledAll(playerGuid, required->second);
 }
 
 void ZoneDifficulty::RewardItem(Player* player, uint8 category, uint8 itemType, uint8 counter, Creature* creature, uint32 itemEntry)
@@ -982,13 +2390,18 @@ void ZoneDifficulty::RewardItem(Player* player, uint8 category, uint8 itemType,
     if (!sZoneDifficulty->CheckCompletionStatus(creature, player, category))
         return;
 
-    uint32 availableScore = player->GetPlayerSetting(ModZoneDifficultyString + "score", category).value;
+    uint32 availableScore = ZoneDifficultyScoreLedger::Get(player).GetScore(category);
+
+    ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+    std::vector<ZoneDifficultyRewardData> const* rewards = snapshot.GetRewards(category, itemType);
+    if (!rewards || rewards->empty())
+        return;
 
-    auto reward = sZoneDifficulty->Rewards[category][itemType][counter];
+    ZoneDifficultyRewardData reward = counter < rewards->size() ? (*rewards)[counter] : rewards->front();
 
     if (itemEntry)
     {
-        for (auto const& item : sZoneDifficulty->Rewards[category][itemType])
+        for (auto const& item : *rewards)
         {
             if (item.Entry == itemEntry)
                 reward = item;
@@ -1036,15 +2449,18 @@ void ZoneDifficulty::LogAndAnnounceKill(Map* map, bool isMythic)
         ChatHandler(nullptr).SendWorldText("Congrats on conquering Black Temple ({}) and defeating Illidan Stormrage! Well done, champions!", isMythic ? "Mythic" : "Normal");
 
         std::string names = "Realm first group: ";
+        std::vector<ZoneDifficultyCompletionLog> logs;
 
         map->DoForAllPlayers([&](Player* mapPlayer) {
             if (!mapPlayer->IsGameMaster())
             {
                 names.append(mapPlayer->GetName() + ", ");
-                CharacterDatabase.Execute("INSERT INTO zone_difficulty_completion_logs (guid, type, mode) VALUES ({}, {}, {})", mapPlayer->GetGUID().GetCounter(), TYPE_RAID_T6, 1);
+                logs.push_back({ mapPlayer->GetGUID().GetCounter(), TYPE_RAID_T6, 1 });
             }
         });
 
+        sZoneDifficulty->LogWriter.QueueCompletionLogs(logs);
+
         ChatHandler(nullptr).SendWorldText(names.c_str());
     }
 };
@@ -1054,7 +2470,7 @@ bool ZoneDifficulty::CheckCompletionStatus(Creature* creature, Player* player, u
     switch (category)
     {
         case TYPE_RAID_SSC:
-            if (!player->GetPlayerSetting(ModZoneDifficultyString + "ct", SETTING_SSC).value)
+            if (!player->GetPlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_SSC).value)
             {
                 creature->Whisper("Ah, hero! The threads of fate bring you to me. To claim the rewards you desire, you must first confront Lady Vashj on Mythic difficulty.",
                     LANG_UNIVERSAL, player);
@@ -1062,7 +2478,7 @@ bool ZoneDifficulty::CheckCompletionStatus(Creature* creature, Player* player, u
             }
             break;
         case TYPE_RAID_T6:
-            if (!player->GetPlayerSetting(ModZoneDifficultyString + "ct", SETTING_BLACK_TEMPLE).value)
+            if (!player->GetPlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_BLACK_TEMPLE).value)
             {
                 creature->Whisper("Ah, hero! The threads of fate bring you to me. To claim the rewards you desire, you must first confront Illidan Stormrage on Mythic difficulty.",
                     LANG_UNIVERSAL, player);
@@ -1070,7 +2486,7 @@ bool ZoneDifficulty::CheckCompletionStatus(Creature* creature, Player* player, u
             }
             break;
         case TYPE_RAID_ZA:
-            if (!player->GetPlayerSetting(ModZoneDifficultyString + "ct", SETTING_ZULAMAN).value)
+            if (!player->GetPlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_ZULAMAN).value)
             {
                 creature->Whisper("Ah, hero! The threads of fate bring you to me. To claim the rewards you desire, you must first confront Zul'jin on Mythic difficulty.",
                     LANG_UNIVERSAL, player);
@@ -1078,7 +2494,7 @@ bool ZoneDifficulty::CheckCompletionStatus(Creature* creature, Player* player, u
             }
             break;
         case TYPE_RAID_HYJAL:
-            if (!player->GetPlayerSetting(ModZoneDifficultyString + "ct", SETTING_HYJAL).value)
+            if (!player->GetPlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_HYJAL).value)
             {
                 creature->Whisper("Ah, hero! The threads of fate bring you to me. To claim the rewards you desire, you must first confront Archimonde on Mythic difficulty.",
                     LANG_UNIVERSAL, player);
@@ -1097,7 +2513,7 @@ void ZoneDifficulty::ProcessCreatureDeath(Map* map, uint32 entry)
         case NPC_ILLIDAN_STORMRAGE:
             map->DoForAllPlayers([&](Player* player)
             {
-                player->UpdatePlayerSetting(ModZoneDifficultyString + "ct", SETTING_BLACK_TEMPLE, 1);
+                player->UpdatePlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_BLACK_TEMPLE, 1);
                 player->SendSystemMessage("Congratulations on completing the Black Temple!");
             });
             sZoneDifficulty->LogAndAnnounceKill(map, true);
@@ -1105,7 +2521,7 @@ void ZoneDifficulty::ProcessCreatureDeath(Map* map, uint32 entry)
         case NPC_ZULJIN:
             map->DoForAllPlayers([&](Player* player)
             {
-                player->UpdatePlayerSetting(ModZoneDifficultyString + "ct", SETTING_ZULAMAN, 1);
+                player->UpdatePlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_ZULAMAN, 1);
                 player->SendSystemMessage("Congratulations on completing Zul'Aman!");
             });
             sZoneDifficulty->LogAndAnnounceKill(map, true);
@@ -1113,7 +2529,7 @@ void ZoneDifficulty::ProcessCreatureDeath(Map* map, uint32 entry)
         case NPC_ARCHIMONDE:
             map->DoForAllPlayers([&](Player* player)
             {
-                player->UpdatePlayerSetting(ModZoneDifficultyString + "ct", SETTING_HYJAL, 1);
+                player->UpdatePlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_HYJAL, 1);
                 player->SendSystemMessage("Congratulations on completing Battle for Mount Hyjal!");
             });
             sZoneDifficulty->LogAndAnnounceKill(map, true);
@@ -1121,10 +2537,172 @@ void ZoneDifficulty::ProcessCreatureDeath(Map* map, uint32 entry)
         case NPC_LADY_VASHJ:
             map->DoForAllPlayers([&](Player* player)
             {
-                player->UpdatePlayerSetting(ModZoneDifficultyString + "ct", SETTING_SSC, 1);
+                player->UpdatePlayerSetting(ModZoneDifficultyCompletionSetting, SETTING_SSC, 1);
                 player->SendSystemMessage("Congratulations on completing Serpentshrine Cavern!");
             });
             sZoneDifficulty->LogAndAnnounceKill(map, true);
             break;
     }
 }
+
+/**
+ *  @brief Scale the base health of an instanced creature to the current tuning data.
+ *  Heavily inspired by https://github.com/azerothcore/mod-autobalance/blob/1d82080237e62376b9a030502264c90b5b8f272b/src/AutoBalance.cpp
+ *
+ *  @param force Scale even if the creature was already scaled for the same snapshot, phase and mode.
+ *  Needed after the core reset the base health, e.g. on respawn.
+ *  @return true if the max health of the creature changed.
+ */
+bool ZoneDifficulty::ScaleCreatureHealth(Creature* creature, bool force)
+{
+    if (!GetSnapshot().HasMapFlag(creature->GetMapId(), MAP_FLAG_CREATURE_SCALING))
+        return false;
+
+    if (!MythicmodeEnable)
+        return false;
+
+    Map* map = creature->GetMap();
+    if (!map)
+        return false;
+
+    if (!map->IsRaid() && (!(map->IsHeroic() && map->IsDungeon())))
+        return false;
+
+    ZoneDifficultySnapshot const& snapshot = GetSnapshot();
+    uint32 mapId = map->GetId();
+    if (!snapshot.ShouldNerfMap(mapId))
+        return false;
+
+    if ((creature->IsHunterPet() || creature->IsPet() || creature->IsSummon()) && creature->IsControlledByPlayer())
+        return false;
+
+    // On respawn the core selects the level while the creature is still dead, the forced pass has to scale it anyway
+    bool isAlive = creature->IsAlive();
+    if (!isAlive && !force)
+        return false;
+
+    CreatureTemplate const* creatureTemplate = creature->GetCreatureTemplate();
+    //skip critters and special creatures (spell summons etc.) in instances
+    if (creatureTemplate->maxlevel <= 1)
+        return false;
+
+    uint32 phaseMask = creature->GetPhaseMask();
+    bool isMythic = IsMythicmodeInstance(map->GetInstanceId());
+
+    ZoneDifficultyScaleMarker* marker = creature->CustomData.GetDefault<ZoneDifficultyScaleMarker>(ScaleMarkerKey);
+    if (!force && marker->Version == snapshot.Version && marker->PhaseMask == phaseMask && marker->IsMythic == isMythic)
+        return false;
+
+    marker->Version = snapshot.Version;
+    marker->PhaseMask = phaseMask;
+    marker->IsMythic = isMythic;
+
+    ZoneDifficultyScaledHealth const& scaled = GetScaledBaseHealth(creatureTemplate, creature->GetLevel(), isMythic);
+
+    // TEMPORARY!!! It conflicts with CC normal mode tuning, dont apply trash tuning to hyjal and ssc
+    if (!scaled.HasOverride && (mapId == 534 || mapId == 548))
+        return false;
+
+    uint32 scaledBaseHealth = scaled.ScaledBaseHealth;
+
+    if (snapshot.GetLowestMatchingPhase(mapId, phaseMask) == -1)
+        return false;
+
+    float scaledHealth = scaledBaseHealth;
+    scaledHealth *= creature->GetModifierValue(UNIT_MOD_HEALTH, BASE_PCT);
+    scaledHealth += creature->GetModifierValue(UNIT_MOD_HEALTH, TOTAL_VALUE);
+    scaledHealth *= creature->GetModifierValue(UNIT_MOD_HEALTH, TOTAL_PCT);
+
+    if (creature->GetMaxHealth() == scaledHealth)
+        return false;
+
+    float percent = creature->GetHealthPct();
+    creature->SetModifierValue(UNIT_MOD_HEALTH, BASE_VALUE, (float)scaledBaseHealth);
+    creature->UpdateMaxHealth();
+    // A respawning creature gets its full health from the core once it is alive again
+    if (!isAlive)
+        return true;
+
+    creature->SetHealth(creature->CountPctFromMaxHealth(percent));
+    creature->ResetPlayerDamageReq();
+    return true;
+}
+
+/**
+ *  @brief The base health of a creature after the generic Mythicmode tuning or its CreatureOverrides entry.
+ *  Memoized per thread, the cache is dropped when a new snapshot is pinned or the config is reloaded.
+ */
+ZoneDifficultyScaledHealth const& ZoneDifficulty::GetScaledBaseHealth(CreatureTemplate const* creatureTemplate, uint8 level, bool isMythic) const
+{
+    ZoneDifficultySnapshot const& snapshot = GetSnapshot();
+    uint32 generation = ConfigGeneration.load(std::memory_order_acquire);
+    if (HealthCache.SnapshotVersion != snapshot.Version || HealthCache.ConfigGeneration != generation)
+    {
+        HealthCache.Entries.clear();
+        HealthCache.SnapshotVersion = snapshot.Version;
+        HealthCache.ConfigGeneration = generation;
+    }
+
+    uint64 key = (uint64(creatureTemplate->Entry) << 32) | (uint64(level) << 16) | (uint64(creatureTemplate->unit_class) << 1) | uint64(isMythic);
+    auto [itr, inserted] = HealthCache.Entries.try_emplace(key);
+    if (!inserted)
+        return itr->second;
+
+    ZoneDifficultyScaledHealth& scaled = itr->second;
+    CreatureBaseStats const* origCreatureStats = sObjectMgr->GetCreatureBaseStats(level, creatureTemplate->unit_class);
+    uint32 baseHealth = origCreatureStats->GenerateHealth(creatureTemplate);
+    scaled.ScaledBaseHealth = baseHealth;
+
+    auto creatureOverride = snapshot.CreatureOverrides.find(creatureTemplate->Entry);
+    if (creatureOverride == snapshot.CreatureOverrides.end())
+    {
+        // Trash mobs. Apply generic tuning.
+        if (!(creatureTemplate->flags_extra & CREATURE_FLAG_EXTRA_DUNGEON_BOSS) && isMythic)
+            scaled.ScaledBaseHealth = round(baseHealth * MythicmodeHpModifier);
+    }
+    else
+    {
+        scaled.HasOverride = true;
+
+        float multiplier = isMythic ? creatureOverride->second.MythicOverride
+            : creatureOverride->second.NormalOverride;
+
+        if (!multiplier)
+            multiplier = 1.0f; // never 0
+
+        scaled.ScaledBaseHealth = round(baseHealth * multiplier);
+    }
+
+    return scaled;
+}
+
+/**
+ *  @brief Re-apply the health scaling to every creature of an instance, summons included, in one pass.
+ *  Must run on the thread updating the map. Health percentages are preserved.
+ *
+ *  @return The amount of creatures whose max health changed.
+ */
+uint32 ZoneDifficulty::RescaleInstanceCreatures(Map* map)
+{
+    CreatureRescaler rescaler;
+    TypeContainerVisitor<CreatureRescaler, MapStoredObjectTypesContainer> visitor(rescaler);
+    visitor.Visit(map->GetObjectsStore());
+    return rescaler.Count;
+}
+
+/**
+ *  @brief Run the rescale queued for an instance, e.g. after the Mythicmode was toggled
+ *  or the tuning data was reloaded. Called from the update of the map itself.
+ */
+void ZoneDifficulty::ProcessPendingRescale(Map* map)
+{
+    uint32 instanceId = map->GetInstanceId();
+    if (!instanceId || !InstanceStates.TakeRescale(instanceId))
+        return;
+
+    uint32 oldMSTime = getMSTime();
+    uint32 count = RescaleInstanceCreatures(map);
+
+    LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Rescaled {} creatures in instance {} (map {}, {}) in {} ms.", count, instanceId, map->GetId(),
+        IsMythicmodeInstance(instanceId) ? "Mythic" : "Normal", GetMSTimeDiffToNow(oldMSTime));
+}
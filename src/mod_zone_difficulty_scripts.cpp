@@ -19,6 +19,7 @@
 #include "Tokenize.h"
 #include "Unit.h"
 #include "ZoneDifficulty.h"
+#include <future>
 
 class mod_zone_difficulty_unitscript : public UnitScript
 {
@@ -29,11 +30,16 @@ public:
         UNITHOOK_MODIFY_PERIODIC_DAMAGE_AURAS_TICK,
         UNITHOOK_MODIFY_SPELL_DAMAGE_TAKEN,
         UNITHOOK_MODIFY_MELEE_DAMAGE,
-        UNITHOOK_ON_UNIT_ENTER_COMBAT
+        UNITHOOK_ON_UNIT_ENTER_COMBAT,
+        UNITHOOK_ON_UNIT_ENTER_EVADE_MODE,
+        UNITHOOK_ON_UNIT_DEATH
     }) { }
 
     void OnAuraApply(Unit* target, Aura* aura) override
     {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(target->GetMapId(), MAP_FLAG_NERF | MAP_FLAG_DUEL_NERF))
+            return;
+
         if (!sZoneDifficulty->IsEnabled)
             return;
 
@@ -42,6 +48,7 @@ public:
 
         if (sZoneDifficulty->IsValidNerfTarget(target))
         {
+            ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
             uint32 mapId = target->GetMapId();
             bool nerfInDuel = sZoneDifficulty->ShouldNerfInDuels(target);
 
@@ -50,13 +57,16 @@ public:
             {
                 if (SpellInfo const* spellInfo = aura->GetSpellInfo())
                 {
+                    uint8 spellClass = sZoneDifficulty->GetSpellClass(spellInfo->Id);
+
                     // Skip spells not affected by vulnerability (potions)
-                    if (spellInfo->HasAttribute(SPELL_ATTR0_NO_IMMUNITIES))
+                    if (spellClass & SPELL_CLASS_NO_IMMUNITIES)
                         return;
 
-                    if (spellInfo->HasAura(SPELL_AURA_SCHOOL_ABSORB))
+                    if (spellClass & SPELL_CLASS_SCHOOL_ABSORB)
                     {
                         std::list<AuraEffect*> AuraEffectList = target->GetAuraEffectsByType(SPELL_AURA_SCHOOL_ABSORB);
+                        ZoneDifficultyNerfMultipliers const* nerf = sZoneDifficulty->GetNerfMultipliers(target);
 
                         for (AuraEffect* eff : AuraEffectList)
                         {
@@ -68,9 +78,6 @@ public:
                                     ChatHandler(player->GetSession()).PSendSysMessage("Spell: {} ({}) Base Value: {}", spellInfo->SpellName[player->GetSession()->GetSessionDbcLocale()], spellInfo->Id, eff->GetAmount());
 
                             int32 absorb = eff->GetAmount();
-                            uint32 phaseMask = target->GetPhaseMask();
-                            int matchingPhase = sZoneDifficulty->GetLowestMatchingPhase(mapId, phaseMask);
-                            int8 mode = sZoneDifficulty->NerfInfo[mapId][matchingPhase].Enabled;
 
                             // Ensure that negative values do not scale to 0
                             auto scaleAbsorb = [](int32 amount, float pct) -> int32
@@ -79,36 +86,21 @@ public:
                                 return (scaled < 0) ? static_cast<int32>(std::floor(scaled)) : static_cast<int32>(scaled);
                             };
 
-                            if (matchingPhase != -1)
-                            {
-                                Map* map = target->GetMap();
-                                uint32 instanceId = map->GetInstanceId();
-                                bool isMythicMode = sZoneDifficulty->MythicmodeInstanceData[instanceId];
-
-                                if (!isMythicMode && sZoneDifficulty->HasNormalMode(mode))
-                                    absorb = scaleAbsorb(absorb, sZoneDifficulty->NerfInfo[mapId][matchingPhase].AbsorbNerfPct);
-
-                                if (isMythicMode && sZoneDifficulty->HasMythicmode(mode))
-                                    if (map->IsRaid() || (map->IsHeroic() && map->IsDungeon()))
-                                        absorb = scaleAbsorb(absorb, sZoneDifficulty->NerfInfo[mapId][matchingPhase].AbsorbNerfPctHard);
-                            }
-                            else if (sZoneDifficulty->NerfInfo[DUEL_INDEX][0].Enabled > 0 && nerfInDuel)
-                                absorb = scaleAbsorb(absorb, sZoneDifficulty->NerfInfo[DUEL_INDEX][0].AbsorbNerfPct);
+                            if (nerf)
+                                absorb = scaleAbsorb(absorb, nerf->Absorb);
+                            else if (snapshot.DuelNerfEnabled && nerfInDuel)
+                                absorb = scaleAbsorb(absorb, snapshot.DuelNerf.Absorb);
 
                             //This check must be last and override duel and map adjustments
-                            if (sZoneDifficulty->SpellNerfOverrides.find(spellInfo->Id) != sZoneDifficulty->SpellNerfOverrides.end())
+                            if (snapshot.SpellOverrideIndex.HasSpell(spellInfo->Id))
                             {
-                                if (sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].find(mapId) != sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].end())
-                                {
-                                    // Check if the mode of instance and SpellNerfOverride match
-                                    if (sZoneDifficulty->OverrideModeMatches(target->GetMap()->GetInstanceId(), spellInfo->Id, mapId))
-                                        absorb = scaleAbsorb(absorb, sZoneDifficulty->SpellNerfOverrides[spellInfo->Id][mapId].NerfPct);
-                                }
-                                else if (sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].find(0) != sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].end())
-                                {
-                                    if (sZoneDifficulty->OverrideModeMatches(target->GetMap()->GetInstanceId(), spellInfo->Id, mapId))
-                                        absorb = scaleAbsorb(absorb, sZoneDifficulty->SpellNerfOverrides[spellInfo->Id][0].NerfPct);
-                                }
+                                ZoneDifficulySpellOverrideData const* spellOverride = snapshot.SpellOverrideIndex.Find(spellInfo->Id, mapId);
+                                if (!spellOverride)
+                                    spellOverride = snapshot.SpellOverrideIndex.Find(spellInfo->Id, 0);
+
+                                // Check if the mode of instance and SpellNerfOverride match
+                                if (spellOverride && sZoneDifficulty->OverrideModeMatches(target->GetInstanceId(), *spellOverride))
+                                    absorb = scaleAbsorb(absorb, spellOverride->NerfPct);
                             }
 
                             eff->SetAmount(absorb);
@@ -127,6 +119,9 @@ public:
 
     void ModifyHealReceived(Unit* target, Unit* /*healer*/, uint32& heal, SpellInfo const* spellInfo) override
     {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(target->GetMapId(), MAP_FLAG_NERF | MAP_FLAG_DUEL_NERF))
+            return;
+
         if (!sZoneDifficulty->IsEnabled)
             return;
 
@@ -135,21 +130,10 @@ public:
 
         if (sZoneDifficulty->IsValidNerfTarget(target))
         {
-            if (spellInfo)
-            {
-                if (spellInfo->HasEffect(SPELL_EFFECT_HEALTH_LEECH))
-                    return;
-
-                for (auto const& eff : spellInfo->GetEffects())
-                {
-                    if (eff.ApplyAuraName == SPELL_AURA_PERIODIC_LEECH)
-                        return;
-                }
-
-                // Skip spells not affected by vulnerability (potions) and bandages
-                if (spellInfo->HasAttribute(SPELL_ATTR0_NO_IMMUNITIES) || spellInfo->Mechanic == MECHANIC_BANDAGE)
-                    return;
-            }
+            ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+            // Skip leech effects, spells not affected by vulnerability (potions) and bandages
+            if (spellInfo && (sZoneDifficulty->GetSpellClass(spellInfo->Id) & SPELL_CLASS_EXEMPT_HEAL))
+                return;
 
             uint32 mapId = target->GetMapId();
             bool nerfInDuel = sZoneDifficulty->ShouldNerfInDuels(target);
@@ -157,105 +141,66 @@ public:
             if (sZoneDifficulty->ShouldNerfMap(mapId) || sZoneDifficulty->ShouldNerfInDuels(target))
             {
                 //This check must be first and skip the rest to override everything else.
-                if (spellInfo)
+                if (spellInfo && snapshot.SpellOverrideIndex.HasSpell(spellInfo->Id))
                 {
-                    if (sZoneDifficulty->SpellNerfOverrides.find(spellInfo->Id) != sZoneDifficulty->SpellNerfOverrides.end())
+                    uint32 instanceId = target->GetInstanceId();
+                    if (ZoneDifficulySpellOverrideData const* spellOverride = snapshot.SpellOverrideIndex.Find(spellInfo->Id, mapId))
                     {
-                        if (sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].find(mapId) != sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].end())
+                        if (sZoneDifficulty->OverrideModeMatches(instanceId, *spellOverride))
                         {
-                            if (sZoneDifficulty->OverrideModeMatches(target->GetMap()->GetInstanceId(), spellInfo->Id, mapId))
-                            {
-                                heal = heal * sZoneDifficulty->SpellNerfOverrides[spellInfo->Id][mapId].NerfPct;
-                                return;
-                            }
+                            heal = heal * spellOverride->NerfPct;
+                            return;
                         }
-                        if (sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].find(0) != sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].end())
+                    }
+                    if (ZoneDifficulySpellOverrideData const* spellOverride = snapshot.SpellOverrideIndex.Find(spellInfo->Id, 0))
+                    {
+                        if (sZoneDifficulty->OverrideModeMatches(instanceId, *spellOverride))
                         {
-                            if (sZoneDifficulty->OverrideModeMatches(target->GetMap()->GetInstanceId(), spellInfo->Id, mapId))
-                            {
-                                heal = heal * sZoneDifficulty->SpellNerfOverrides[spellInfo->Id][0].NerfPct;
-                                return;
-                            }
+                            heal = heal * spellOverride->NerfPct;
+                            return;
                         }
                     }
                 }
 
-                uint32 phaseMask = target->GetPhaseMask();
-                int matchingPhase = sZoneDifficulty->GetLowestMatchingPhase(mapId, phaseMask);
-                int8 mode = sZoneDifficulty->NerfInfo[mapId][matchingPhase].Enabled;
-                if (matchingPhase != -1)
-                {
-                    Map* map = target->GetMap();
-                    uint32 instanceId = map->GetInstanceId();
-                    bool isMythicMode = sZoneDifficulty->MythicmodeInstanceData[instanceId];
-
-                    if (!isMythicMode && sZoneDifficulty->HasNormalMode(mode))
-                        heal = heal * sZoneDifficulty->NerfInfo[mapId][matchingPhase].HealingNerfPct;
-
-                    if (isMythicMode && sZoneDifficulty->HasMythicmode(mode))
-                        if (map->IsRaid() || (map->IsHeroic() && map->IsDungeon()))
-                            heal = heal * sZoneDifficulty->NerfInfo[mapId][matchingPhase].HealingNerfPctHard;
-                }
-                else if (sZoneDifficulty->NerfInfo[DUEL_INDEX][0].Enabled > 0 && nerfInDuel)
-                    heal = heal * sZoneDifficulty->NerfInfo[DUEL_INDEX][0].HealingNerfPct;
+                if (ZoneDifficultyNerfMultipliers const* nerf = sZoneDifficulty->GetNerfMultipliers(target))
+                    heal = heal * nerf->Healing;
+                else if (snapshot.DuelNerfEnabled && nerfInDuel)
+                    heal = heal * snapshot.DuelNerf.Healing;
             }
         }
     }
 
     void ModifyPeriodicDamageAurasTick(Unit* target, Unit* attacker, uint32& damage, SpellInfo const* spellInfo) override
     {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(target->GetMapId(), MAP_FLAG_NERF | MAP_FLAG_DUEL_NERF))
+            return;
+
         if (!sZoneDifficulty->IsEnabled)
             return;
 
         if (!sZoneDifficulty->MythicmodeInNormalDungeons && !target->GetMap()->IsRaidOrHeroicDungeon())
             return;
 
-        bool isDot = false;
-
-        if (spellInfo)
-        {
-            for (auto const& eff : spellInfo->GetEffects())
-            {
-                if (eff.ApplyAuraName == SPELL_AURA_PERIODIC_DAMAGE || eff.ApplyAuraName == SPELL_AURA_PERIODIC_DAMAGE_PERCENT)
-                    isDot = true;
-            }
-        }
-
-        if (!isDot)
+        if (!spellInfo || !(sZoneDifficulty->GetSpellClass(spellInfo->Id) & SPELL_CLASS_DOT))
             return;
 
         // Disclaimer: also affects disables boss adds buff.
-        if (sConfigMgr->GetOption<bool>("ModZoneDifficulty.SpellBuff.OnlyBosses", false))
+        if (sZoneDifficulty->SpellBuffOnlyBosses)
             if (attacker->ToCreature() && !attacker->ToCreature()->IsDungeonBoss())
                 return;
 
         if (sZoneDifficulty->IsValidNerfTarget(target))
         {
-            uint32 mapId = target->GetMapId();
-            uint32 phaseMask = target->GetPhaseMask();
-            int32 matchingPhase = sZoneDifficulty->GetLowestMatchingPhase(mapId, phaseMask);
-
+            ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
             if (sZoneDifficulty->IsDebugInfoEnabled && attacker)
                 if (Player* player = attacker->ToPlayer())
                     ChatHandler(player->GetSession()).PSendSysMessage("A dot tick will be altered. Pre Nerf Value: {}", damage);
 
-            if (sZoneDifficulty->ShouldNerfMap(mapId) && matchingPhase != -1)
-            {
-                int8 mode = sZoneDifficulty->NerfInfo[mapId][matchingPhase].Enabled;
-                Map* map = target->GetMap();
-                uint32 instanceId = map->GetInstanceId();
-                bool isMythicMode = sZoneDifficulty->MythicmodeInstanceData[instanceId];
-
-                if (!isMythicMode && sZoneDifficulty->HasNormalMode(mode))
-                    damage = damage * sZoneDifficulty->NerfInfo[mapId][matchingPhase].SpellDamageBuffPct;
-
-                if (isMythicMode && sZoneDifficulty->HasMythicmode(mode))
-                    if (map->IsRaid() || (map->IsHeroic() && map->IsDungeon()))
-                        damage = damage * sZoneDifficulty->NerfInfo[mapId][matchingPhase].SpellDamageBuffPctHard;
-            }
+            if (ZoneDifficultyNerfMultipliers const* nerf = sZoneDifficulty->GetNerfMultipliers(target))
+                damage = damage * nerf->SpellDamage;
             else if (sZoneDifficulty->ShouldNerfInDuels(target))
-                if (sZoneDifficulty->NerfInfo[DUEL_INDEX][0].Enabled > 0)
-                    damage = damage * sZoneDifficulty->NerfInfo[DUEL_INDEX][0].SpellDamageBuffPct;
+                if (snapshot.DuelNerfEnabled)
+                    damage = damage * snapshot.DuelNerf.SpellDamage;
 
             if (sZoneDifficulty->IsDebugInfoEnabled && attacker)
                 if (Player* player = attacker->ToPlayer())
@@ -265,6 +210,11 @@ public:
 
     void ModifySpellDamageTaken(Unit* target, Unit* attacker, int32& damage, SpellInfo const* spellInfo) override
     {
+        // Spell overrides also apply on maps without zone_difficulty_info rows, MapId 0 on every map
+        ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+        if (!snapshot.HasMapFlag(target->GetMapId(), MAP_FLAG_NERF | MAP_FLAG_DUEL_NERF) && !(spellInfo && snapshot.SpellOverrideIndex.HasSpell(spellInfo->Id)))
+            return;
+
         if (!sZoneDifficulty->IsEnabled)
             return;
 
@@ -272,35 +222,27 @@ public:
             return;
 
         // Disclaimer: also affects disables boss adds buff.
-        if (sConfigMgr->GetOption<bool>("ModZoneDifficulty.SpellBuff.OnlyBosses", false))
+        if (sZoneDifficulty->SpellBuffOnlyBosses)
             if (attacker->ToCreature() && !attacker->ToCreature()->IsDungeonBoss())
                 return;
 
         if (sZoneDifficulty->IsValidNerfTarget(target))
         {
             uint32 mapId = target->GetMapId();
-            uint32 phaseMask = target->GetPhaseMask();
-            int32 matchingPhase = sZoneDifficulty->GetLowestMatchingPhase(mapId, phaseMask);
+            ZoneDifficultyNerfMultipliers const* nerf = sZoneDifficulty->GetNerfMultipliers(target);
             if (spellInfo)
             {
                 //This check must be first and skip the rest to override everything else.
-                if (sZoneDifficulty->SpellNerfOverrides.find(spellInfo->Id) != sZoneDifficulty->SpellNerfOverrides.end())
+                if (snapshot.SpellOverrideIndex.HasSpell(spellInfo->Id))
                 {
-                    if (sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].find(mapId) != sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].end())
-                    {
-                        if (sZoneDifficulty->OverrideModeMatches(target->GetMap()->GetInstanceId(), spellInfo->Id, mapId))
-                        {
-                            damage = damage * sZoneDifficulty->SpellNerfOverrides[spellInfo->Id][mapId].NerfPct;
-                            return;
-                        }
-                    }
-                    else if (sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].find(0) != sZoneDifficulty->SpellNerfOverrides[spellInfo->Id].end())
+                    ZoneDifficulySpellOverrideData const* spellOverride = snapshot.SpellOverrideIndex.Find(spellInfo->Id, mapId);
+                    if (!spellOverride)
+                        spellOverride = snapshot.SpellOverrideIndex.Find(spellInfo->Id, 0);
+
+                    if (spellOverride && sZoneDifficulty->OverrideModeMatches(target->GetInstanceId(), *spellOverride))
                     {
-                        if (sZoneDifficulty->OverrideModeMatches(target->GetMap()->GetInstanceId(), spellInfo->Id, mapId))
-                        {
-                            damage = damage * sZoneDifficulty->SpellNerfOverrides[spellInfo->Id][0].NerfPct;
-                            return;
-                        }
+                        damage = damage * spellOverride->NerfPct;
+                        return;
                     }
                 }
 
@@ -308,29 +250,17 @@ public:
                 {
                     if (Player* player = target->ToPlayer()) // Pointless check? Perhaps.
                     {
-                        ChatHandler(player->GetSession()).PSendSysMessage("Spell: {} ({}) Before Nerf Value: {} ({} Normal Mode)", spellInfo->SpellName[player->GetSession()->GetSessionDbcLocale()], spellInfo->Id, damage, sZoneDifficulty->NerfInfo[mapId][matchingPhase].SpellDamageBuffPct);
-                        ChatHandler(player->GetSession()).PSendSysMessage("Spell: {} ({}) Before Nerf Value: {} ({} Mythic Mode)", spellInfo->SpellName[player->GetSession()->GetSessionDbcLocale()], spellInfo->Id, damage, sZoneDifficulty->NerfInfo[mapId][matchingPhase].SpellDamageBuffPctHard);
+                        ChatHandler(player->GetSession()).PSendSysMessage("Spell: {} ({}) Before Nerf Value: {} ({} {} Mode)", spellInfo->SpellName[player->GetSession()->GetSessionDbcLocale()], spellInfo->Id, damage, nerf ? nerf->SpellDamage : 1.0f,
+                            sZoneDifficulty->IsMythicmodeInstance(target->GetInstanceId()) ? "Mythic" : "Normal");
                     }
                 }
             }
 
-            if (sZoneDifficulty->ShouldNerfMap(mapId) && matchingPhase != -1)
-            {
-                int8 mode = sZoneDifficulty->NerfInfo[mapId][matchingPhase].Enabled;
-                Map* map = target->GetMap();
-                uint32 instanceId = map->GetInstanceId();
-                bool isMythicMode = sZoneDifficulty->MythicmodeInstanceData[instanceId];
-
-                if (!isMythicMode && sZoneDifficulty->HasNormalMode(mode))
-                    damage = damage * sZoneDifficulty->NerfInfo[mapId][matchingPhase].SpellDamageBuffPct;
-
-                if (isMythicMode && sZoneDifficulty->HasMythicmode(mode))
-                    if (map->IsRaid() || (map->IsHeroic() && map->IsDungeon()))
-                        damage = damage * sZoneDifficulty->NerfInfo[mapId][matchingPhase].SpellDamageBuffPctHard;
-            }
+            if (nerf)
+                damage = damage * nerf->SpellDamage;
             else if (sZoneDifficulty->ShouldNerfInDuels(target))
-                if (sZoneDifficulty->NerfInfo[DUEL_INDEX][0].Enabled > 0)
-                    damage = damage * sZoneDifficulty->NerfInfo[DUEL_INDEX][0].SpellDamageBuffPct;
+                if (snapshot.DuelNerfEnabled)
+                    damage = damage * snapshot.DuelNerf.SpellDamage;
 
             if (sZoneDifficulty->IsDebugInfoEnabled && target)
                 if (Player* player = target->ToPlayer()) // Pointless check? Perhaps.
@@ -340,6 +270,9 @@ public:
 
     void ModifyMeleeDamage(Unit* target, Unit* attacker, uint32& damage) override
     {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(target->GetMapId(), MAP_FLAG_NERF | MAP_FLAG_DUEL_NERF))
+            return;
+
         if (!sZoneDifficulty->IsEnabled)
             return;
 
@@ -347,32 +280,18 @@ public:
             return;
 
         // Disclaimer: also affects disables boss adds buff.
-        if (sConfigMgr->GetOption<bool>("ModZoneDifficulty.MeleeBuff.OnlyBosses", false))
+        if (sZoneDifficulty->MeleeBuffOnlyBosses)
             if (attacker->ToCreature() && !attacker->ToCreature()->IsDungeonBoss())
                 return;
 
         if (sZoneDifficulty->IsValidNerfTarget(target))
         {
-            uint32 mapId = target->GetMapId();
-            uint32 phaseMask = target->GetPhaseMask();
-            int matchingPhase = sZoneDifficulty->GetLowestMatchingPhase(mapId, phaseMask);
-            if (sZoneDifficulty->ShouldNerfMap(mapId) && matchingPhase != -1)
-            {
-                int8 mode = sZoneDifficulty->NerfInfo[mapId][matchingPhase].Enabled;
-                Map* map = target->GetMap();
-                uint32 instanceId = map->GetInstanceId();
-                bool isMythicMode = sZoneDifficulty->MythicmodeInstanceData[instanceId];
-
-                if (!isMythicMode && sZoneDifficulty->HasNormalMode(mode))
-                    damage = damage * sZoneDifficulty->NerfInfo[mapId][matchingPhase].MeleeDamageBuffPct;
-
-                if (isMythicMode && sZoneDifficulty->HasMythicmode(mode))
-                    if (map->IsRaid() || (map->IsHeroic() && map->IsDungeon()))
-                        damage = damage * sZoneDifficulty->NerfInfo[mapId][matchingPhase].MeleeDamageBuffPctHard;
-            }
+            ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+            if (ZoneDifficultyNerfMultipliers const* nerf = sZoneDifficulty->GetNerfMultipliers(target))
+                damage = damage * nerf->MeleeDamage;
             else if (sZoneDifficulty->ShouldNerfInDuels(target))
-                if (sZoneDifficulty->NerfInfo[DUEL_INDEX][0].Enabled > 0)
-                    damage = damage * sZoneDifficulty->NerfInfo[DUEL_INDEX][0].MeleeDamageBuffPct;
+                if (snapshot.DuelNerfEnabled)
+                    damage = damage * snapshot.DuelNerf.MeleeDamage;
         }
     }
 
@@ -381,10 +300,10 @@ public:
      */
     void OnUnitEnterCombat(Unit* unit, Unit* /*victim*/) override
     {
-        if (sZoneDifficulty->MythicmodeInstanceData.find(unit->GetInstanceId()) == sZoneDifficulty->MythicmodeInstanceData.end())
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(unit->GetMapId(), MAP_FLAG_MYTHIC))
             return;
 
-        if (!sZoneDifficulty->MythicmodeInstanceData[unit->GetInstanceId()])
+        if (!sZoneDifficulty->IsMythicmodeInstance(unit->GetInstanceId()))
             return;
 
         if (Creature* creature = unit->ToCreature())
@@ -392,24 +311,37 @@ public:
                 return;
 
         uint32 entry = unit->GetEntry();
-        if (sZoneDifficulty->MythicmodeAI.find(entry) == sZoneDifficulty->MythicmodeAI.end())
+        std::span<ZoneDifficultyHAI const> program = sZoneDifficulty->GetSnapshot().GetMythicProgram(entry);
+        if (program.empty())
             return;
 
-        unit->m_Events.CancelEventGroup(EVENT_GROUP);
+        sZoneDifficulty->CancelMythicAbilities(unit);
 
         uint32 i = 0;
-        for (ZoneDifficultyHAI& data : sZoneDifficulty->MythicmodeAI[entry])
+        for (ZoneDifficultyHAI const& data : program)
         {
             if (data.Chance == 100 || data.Chance >= urand(1, 100))
-            {
-                unit->m_Events.AddEventAtOffset([unit, entry, i]()
-                    {
-                        sZoneDifficulty->MythicmodeEvent(unit, entry, i);
-                    }, data.Delay, EVENT_GROUP);
-            }
+                sZoneDifficulty->ScheduleMythicAbility(unit, entry, i, data.Delay);
+
             ++i;
         }
     }
+
+    void OnUnitEnterEvadeMode(Unit* unit, uint8 /*evadeReason*/) override
+    {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(unit->GetMapId(), MAP_FLAG_MYTHIC))
+            return;
+
+        sZoneDifficulty->CancelMythicAbilities(unit);
+    }
+
+    void OnUnitDeath(Unit* unit, Unit* /*killer*/) override
+    {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(unit->GetMapId(), MAP_FLAG_MYTHIC))
+            return;
+
+        sZoneDifficulty->CancelMythicAbilities(unit);
+    }
 };
 
 class mod_zone_difficulty_petscript : public PetScript
@@ -422,11 +354,16 @@ public:
     void OnPetAddToWorld(Pet* pet) override
     {
         uint32 mapId = pet->GetMapId();
-        if (sZoneDifficulty->DisallowedBuffs.find(mapId) != sZoneDifficulty->DisallowedBuffs.end())
+        if (sZoneDifficulty->GetSnapshot().HasMapFlag(mapId, MAP_FLAG_DISALLOWED_BUFFS))
         {
             pet->m_Events.AddEventAtOffset([mapId, pet]()
                 {
-                    for (uint32 aura : sZoneDifficulty->DisallowedBuffs[mapId])
+                    ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+                    auto itr = snapshot.DisallowedBuffs.find(mapId);
+                    if (itr == snapshot.DisallowedBuffs.end())
+                        return;
+
+                    for (uint32 aura : itr->second)
                     {
                         pet->RemoveAurasDueToSpell(aura);
                     }
@@ -440,10 +377,12 @@ class mod_zone_difficulty_worldscript : public WorldScript
 public:
     mod_zone_difficulty_worldscript() : WorldScript("mod_zone_difficulty_worldscript", {
         WORLDHOOK_ON_AFTER_CONFIG_LOAD,
-        WORLDHOOK_ON_STARTUP
+        WORLDHOOK_ON_STARTUP,
+        WORLDHOOK_ON_UPDATE,
+        WORLDHOOK_ON_SHUTDOWN
     }) { }
 
-    void OnAfterConfigLoad(bool /*reload*/) override
+    void OnAfterConfigLoad(bool reload) override
     {
         sZoneDifficulty->IsEnabled = sConfigMgr->GetOption<bool>("ModZoneDifficulty.Enable", false);
         sZoneDifficulty->IsDebugInfoEnabled = sConfigMgr->GetOption<bool>("ModZoneDifficulty.DebugInfo", false);
@@ -451,7 +390,25 @@ public:
         sZoneDifficulty->MythicmodeEnable = sConfigMgr->GetOption<bool>("ModZoneDifficulty.Mythicmode.Enable", false);
         sZoneDifficulty->MythicmodeInNormalDungeons = sConfigMgr->GetOption<bool>("ModZoneDifficulty.Mythicmode.InNormalDungeons", false);
         sZoneDifficulty->UseVendorInterface = sConfigMgr->GetOption<bool>("ModZoneDifficulty.UseVendorInterface", false);
-        sZoneDifficulty->LoadMapDifficultySettings();
+        sZoneDifficulty->SpellBuffOnlyBosses = sConfigMgr->GetOption<bool>("ModZoneDifficulty.SpellBuff.OnlyBosses", false);
+        sZoneDifficulty->MeleeBuffOnlyBosses = sConfigMgr->GetOption<bool>("ModZoneDifficulty.MeleeBuff.OnlyBosses", false);
+        sZoneDifficulty->LogWriter.FlushInterval = Milliseconds(sConfigMgr->GetOption<uint32>("ModZoneDifficulty.Log.FlushInterval", 2000));
+        sZoneDifficulty->InstanceSaves.FlushInterval = Milliseconds(sConfigMgr->GetOption<uint32>("ModZoneDifficulty.InstanceSave.FlushInterval", 2000));
+        sZoneDifficulty->TuningCacheFile = sConfigMgr->GetOption<std::string>("ModZoneDifficulty.TuningCache.File", "");
+        ++sZoneDifficulty->ConfigGeneration;
+
+        // The Mythicmode AI is validated against the spell store, which is not loaded yet on the first call. OnStartup loads it then.
+        if (reload)
+        {
+            sZoneDifficulty->LoadMapDifficultySettings();
+
+            // Creatures are only scaled on events, so bring the spawned ones up to date with the new data
+            sMapMgr->DoForAllMaps([](Map* map)
+            {
+                if (map->IsDungeon() && map->GetInstanceId())
+                    sZoneDifficulty->InstanceStates.QueueRescale(map->GetInstanceId());
+            });
+        }
 
         if (CharacterDatabase.Query("SELECT 1 FROM zone_difficulty_completion_logs WHERE type = {}", TYPE_RAID_T6))
             sZoneDifficulty->IsBlackTempleDone = true;
@@ -459,8 +416,58 @@ public:
 
     void OnStartup() override
     {
-        sZoneDifficulty->LoadMythicmodeInstanceData();
-        sZoneDifficulty->LoadMythicmodeScoreData();
+        // The character tables do not depend on the world tables, load both at the same time
+        std::future<void> characterData = std::async(std::launch::async, []() { sZoneDifficulty->LoadCharacterData(); });
+        sZoneDifficulty->LoadMapDifficultySettings();
+        sZoneDifficulty->LoadSpellClasses();
+        characterData.get();
+    }
+
+    void OnUpdate(uint32 /*diff*/) override
+    {
+        // Scripts running on the world thread read the snapshot pinned here until the next tick.
+        sZoneDifficulty->PinSnapshot();
+        sZoneDifficulty->LogWriter.Update();
+        sZoneDifficulty->Progress.Update();
+        sZoneDifficulty->InstanceSaves.Update();
+    }
+
+    void OnShutdown() override
+    {
+        sZoneDifficulty->LogWriter.Flush();
+        sZoneDifficulty->InstanceSaves.Flush();
+    }
+};
+
+class mod_zone_difficulty_allmapscript : public AllMapScript
+{
+public:
+    mod_zone_difficulty_allmapscript() : AllMapScript("mod_zone_difficulty_allmapscript", {
+        ALLMAPHOOK_ON_MAP_UPDATE,
+        ALLMAPHOOK_ON_DESTROY_MAP
+    }) { }
+
+    void OnMapUpdate(Map* map, uint32 /*diff*/) override
+    {
+        // The core calls this at the end of Map::Update. The pin is refreshed between updates only, so the hooks of the
+        // next update this thread runs, for whatever map, all see the same tuning data even if a reload publishes meanwhile.
+        sZoneDifficulty->PinSnapshot();
+
+        if (map->IsDungeon())
+        {
+            sZoneDifficulty->ProcessPendingRescale(map);
+            sZoneDifficulty->UpdateMythicAbilities(map);
+        }
+    }
+
+    void OnDestroyMap(Map* map) override
+    {
+        if (map->IsDungeon() && map->GetInstanceId())
+        {
+            // Write the flag before the instance can be reloaded from the database
+            sZoneDifficulty->InstanceSaves.Flush(map->GetInstanceId());
+            sZoneDifficulty->InstanceStates.ReleaseAbilityWheel(map->GetInstanceId());
+        }
     }
 };
 
@@ -475,6 +482,9 @@ public:
 
     void OnBeforeSetBossState(uint32 id, EncounterState newState, EncounterState oldState, Map* instance) override
     {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(instance->GetId(), MAP_FLAG_MYTHIC))
+            return;
+
         if (!sZoneDifficulty->MythicmodeEnable)
             return;
 
@@ -493,25 +503,31 @@ public:
         }
         if (oldState != IN_PROGRESS && newState == IN_PROGRESS)
         {
-            if (sZoneDifficulty->MythicmodeInstanceData[instanceId])
-                sZoneDifficulty->EncountersInProgress[instanceId] = GameTime::GetGameTime().count();
+            if (sZoneDifficulty->IsMythicmodeInstance(instanceId))
+                sZoneDifficulty->InstanceStates.SetEncounterStartTime(instanceId, GameTime::GetGameTime().count());
         }
         else if (oldState == IN_PROGRESS && newState == DONE)
         {
-            if (sZoneDifficulty->MythicmodeInstanceData[instanceId])
+            if (sZoneDifficulty->IsMythicmodeInstance(instanceId))
             {
                 if ((id == 7 /* Illidari Council*/ || id == 5 /* Reliquary of Souls*/) && instance->GetId() == 564)
                     sZoneDifficulty->AddMythicmodeScore(instance, TYPE_RAID_T6, 1);
 
                 //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Mythicmode is on.");
-                if (sZoneDifficulty->EncountersInProgress.find(instanceId) != sZoneDifficulty->EncountersInProgress.end() && sZoneDifficulty->EncountersInProgress[instanceId] != 0)
+                if (uint32 startTime = sZoneDifficulty->InstanceStates.GetEncounterStartTime(instanceId))
                 {
+                    std::vector<ZoneDifficultyEncounterLog> logs;
+                    uint32 endTime = GameTime::GetGameTime().count();
                     instance->DoForAllPlayers([&](Player* player)
                     {
                         if (!player->IsGameMaster() && !player->IsDeveloper())
-                            CharacterDatabase.Execute("REPLACE INTO `zone_difficulty_encounter_logs` VALUES({}, {}, {}, {}, {}, {}, {})",
-                                instanceId, sZoneDifficulty->EncountersInProgress[instanceId], GameTime::GetGameTime().count(), instance->GetId(), id, player->GetGUID().GetCounter(), 64);
+                        {
+                            logs.push_back({ instanceId, startTime, endTime, instance->GetId(), id, player->GetGUID().GetCounter(), 64 });
+                            sZoneDifficulty->Progress.MarkKilled(player->GetGUID().GetCounter(), instance->GetId(), id);
+                        }
                     });
+
+                    sZoneDifficulty->LogWriter.QueueEncounterLogs(logs);
                 }
             }
         }
@@ -520,16 +536,17 @@ public:
     void OnInstanceIdRemoved(uint32 instanceId) override
     {
         //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: OnInstanceIdRemoved: instanceId = {}", instanceId);
-        if (sZoneDifficulty->MythicmodeInstanceData.find(instanceId) != sZoneDifficulty->MythicmodeInstanceData.end())
-        {
-            sZoneDifficulty->MythicmodeInstanceData.erase(instanceId);
-        }
+        sZoneDifficulty->InstanceStates.Reset(instanceId);
 
-        CharacterDatabase.Execute("DELETE FROM zone_difficulty_instance_saves WHERE InstanceID = {};", instanceId);
+        // Deleted together with the other instances expiring before the next flush
+        sZoneDifficulty->InstanceSaves.QueueDelete(instanceId);
     }
 
     void OnAfterUpdateEncounterState(Map* map, EncounterCreditType /*type*/, uint32 /*creditEntry*/, Unit* source, Difficulty /*difficulty_fixed*/, DungeonEncounterList const* /*encounters*/, uint32 /*dungeonCompleted*/, bool /*updated*/) override
     {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(map->GetId(), MAP_FLAG_MYTHIC))
+            return;
+
         if (!sZoneDifficulty->MythicmodeEnable)
         {
             return;
@@ -540,54 +557,59 @@ public:
             return;
         }
 
-        if (sZoneDifficulty->MythicmodeInstanceData.find(map->GetInstanceId()) != sZoneDifficulty->MythicmodeInstanceData.end())
+        if (sZoneDifficulty->IsMythicmodeInstance(map->GetInstanceId()))
         {
             //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Encounter completed. Map relevant. Checking for source: {}", source->GetEntry());
             // Give additional loot, if the encounter was in Mythicmode.
-            if (sZoneDifficulty->MythicmodeInstanceData[map->GetInstanceId()])
+            uint32 mapId = map->GetId();
+            uint32 score = 0;
+            if (!sZoneDifficulty->IsMythicmodeMap(mapId) ||
+                (!sZoneDifficulty->MythicmodeInNormalDungeons && !map->IsRaidOrHeroicDungeon()))
             {
-                uint32 mapId = map->GetId();
-                uint32 score = 0;
-                if (!sZoneDifficulty->IsMythicmodeMap(mapId) ||
-                    (!sZoneDifficulty->MythicmodeInNormalDungeons && !map->IsRaidOrHeroicDungeon()))
-                {
-                    //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: No additional loot stored in map with id {}.", map->GetInstanceId());
-                    return;
-                }
+                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: No additional loot stored in map with id {}.", map->GetInstanceId());
+                return;
+            }
 
-                bool SourceAwardsMythicmodeLoot = false;
-                //iterate over all listed creature entries for that map id and see, if the encounter should yield Mythicmode loot and if there is an override to the default behaviour
-                for (auto value : sZoneDifficulty->MythicmodeLoot[mapId])
+            ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+            auto loot = snapshot.MythicmodeLoot.find(mapId);
+            if (loot == snapshot.MythicmodeLoot.end())
+                return;
+
+            bool SourceAwardsMythicmodeLoot = false;
+            //iterate over all listed creature entries for that map id and see, if the encounter should yield Mythicmode loot and if there is an override to the default behaviour
+            for (auto const& value : loot->second)
+            {
+                if (value.EncounterEntry == source->GetEntry())
                 {
-                    if (value.EncounterEntry == source->GetEntry())
-                    {
-                        SourceAwardsMythicmodeLoot = true;
-                        if (!(value.Override & 1))
-                            score = 1;
+                    SourceAwardsMythicmodeLoot = true;
+                    if (!(value.Override & 1))
+                        score = 1;
 
-                        break;
-                    }
+                    break;
                 }
+            }
 
-                if (!SourceAwardsMythicmodeLoot)
-                    return;
+            if (!SourceAwardsMythicmodeLoot)
+                return;
 
-                if (map->IsHeroic() && map->IsNonRaidDungeon())
-                {
-                    sZoneDifficulty->AddMythicmodeScore(map, sZoneDifficulty->Expansion[mapId], score);
-                }
-                else if (map->IsRaid())
-                {
-                    sZoneDifficulty->AddMythicmodeScore(map, sZoneDifficulty->Expansion[mapId], score);
-                    sZoneDifficulty->ProcessCreatureDeath(map, source->GetEntry());
-                }
-                /* debug
-                 * else
-                 * {
-                 *   LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Map with id {} is not a raid or a dungeon. Mythicmode loot not granted.", map->GetInstanceId());
-                 * }
-                 */
+            auto expansion = snapshot.Expansion.find(mapId);
+            uint32 type = expansion != snapshot.Expansion.end() ? expansion->second : TYPE_NONE;
+
+            if (map->IsHeroic() && map->IsNonRaidDungeon())
+            {
+                sZoneDifficulty->AddMythicmodeScore(map, type, score);
+            }
+            else if (map->IsRaid())
+            {
+                sZoneDifficulty->AddMythicmodeScore(map, type, score);
+                sZoneDifficulty->ProcessCreatureDeath(map, source->GetEntry());
             }
+            /* debug
+             * else
+             * {
+             *   LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Map with id {} is not a raid or a dungeon. Mythicmode loot not granted.", map->GetInstanceId());
+             * }
+             */
         }
     }
 };
@@ -622,9 +644,10 @@ public:
         {
             npcText = NPC_TEXT_SCORE;
             bool hasAnyScore = false;
-            for (int i = 1; i <= TYPE_MAX_TIERS; ++i)
+            ZoneDifficultyScoreLedger const& ledger = ZoneDifficultyScoreLedger::Get(player);
+            for (int i = 1; i < TYPE_MAX_TIERS; ++i)
             {
-                if (uint32 score = player->GetPlayerSetting(ModZoneDifficultyString + "score", i).value)
+                if (uint32 score = ledger.GetScore(i))
                 {
                     creature->Whisper(Acore::StringFormat("Your score is {} {}", score, sZoneDifficulty->GetContentTypeString(i)), LANG_UNIVERSAL, player);
                     hasAnyScore = true;
@@ -644,9 +667,10 @@ public:
             uint32 category = action - 99001000;
 
             // Check (again) if the player has enough score in the respective category.
-            uint32 availableScore = player->GetPlayerSetting(ModZoneDifficultyString + "score", category).value;
+            uint32 availableScore = ZoneDifficultyScoreLedger::Get(player).GetScore(category);
+            ZoneDifficultyRewardData const* reward = sZoneDifficulty->GetSnapshot().GetTierReward(category);
 
-            if (availableScore < sZoneDifficulty->TierRewards[category].Price)
+            if (!reward || availableScore < reward->Price)
             {
                 CloseGossipMenuFor(player);
                 return true;
@@ -660,8 +684,8 @@ public:
             }
 
             //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Sending full tier clearance reward for category {}", category);
-            sZoneDifficulty->DeductMythicmodeScore(player, category, sZoneDifficulty->TierRewards[category].Price);
-            sZoneDifficulty->SendItem(player, sZoneDifficulty->TierRewards[category]);
+            sZoneDifficulty->DeductMythicmodeScore(player, category, reward->Price);
+            sZoneDifficulty->SendItem(player, *reward);
 
             return true;
         }
@@ -670,17 +694,18 @@ public:
         if (action > 99000000)
         {
             uint32 category = action - 99000000;
-            if (sZoneDifficulty->HasCompletedFullTier(category, player->GetGUID().GetCounter()))
+            ZoneDifficultyRewardData const* reward = sZoneDifficulty->GetSnapshot().GetTierReward(category);
+            if (reward && sZoneDifficulty->HasCompletedFullTier(category, player->GetGUID().GetCounter()))
             {
                 // Check if the player has enough score in the respective category.
-                uint32 availableScore = player->GetPlayerSetting(ModZoneDifficultyString + "score", category).value;
+                uint32 availableScore = ZoneDifficultyScoreLedger::Get(player).GetScore(category);
 
-                if (availableScore < sZoneDifficulty->TierRewards[category].Price)
+                if (availableScore < reward->Price)
                 {
                     npcText = NPC_TEXT_DENIED;
                     SendGossipMenuFor(player, npcText, creature);
                     std::string whisper = Acore::StringFormat("I am sorry, time-traveler. This reward costs {} score but you only have {} {}",
-                        sZoneDifficulty->TierRewards[category].Price,
+                        reward->Price,
                         availableScore,
                         sZoneDifficulty->GetContentTypeString(category));
 
@@ -689,11 +714,11 @@ public:
                 }
                 npcText = NPC_TEXT_CONFIRM;
 
-                if (ItemTemplate const* proto = sObjectMgr->GetItemTemplate(sZoneDifficulty->TierRewards[category].Entry))
+                if (ItemTemplate const* proto = sObjectMgr->GetItemTemplate(reward->Entry))
                 {
                     std::string name = proto->Name1;
 
-                    if (ItemLocale const* leftIl = sObjectMgr->GetItemLocale(sZoneDifficulty->TierRewards[category].Entry))
+                    if (ItemLocale const* leftIl = sObjectMgr->GetItemLocale(reward->Entry))
                         ObjectMgr::GetLocaleString(leftIl->Name, player->GetSession()->GetSessionDbcLocale(), name);
 
                     AddGossipItemFor(player, GOSSIP_ICON_CHAT, "No!", GOSSIP_SENDER_MAIN, 999998);
@@ -713,15 +738,21 @@ public:
             if (sZoneDifficulty->HasCompletedFullTier(action, player->GetGUID().GetCounter()))
                 AddGossipItemFor(player, GOSSIP_ICON_MONEY_BAG, Acore::StringFormat("I want to redeem the ultimate Mythicmode reward {}", sZoneDifficulty->GetContentTypeString(action)), GOSSIP_SENDER_MAIN, 99000000 + action);
 
-            uint32 i = 1;
-            for (auto& itemType : sZoneDifficulty->Rewards[action])
+            ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+            auto categoryItr = snapshot.Rewards.find(action);
+            if (categoryItr != snapshot.Rewards.end())
             {
-                std::string typestring = sZoneDifficulty->GetItemTypeString(itemType.first);
-                if (sZoneDifficulty->ItemIcons.find(i) != sZoneDifficulty->ItemIcons.end())
-                    AddGossipItemFor(player, GOSSIP_ICON_CHAT, Acore::StringFormat("{} I am interested in items from the {} category.", sZoneDifficulty->ItemIcons[i], typestring), GOSSIP_SENDER_MAIN, itemType.first + (action * 100));
-                else
-                    AddGossipItemFor(player, GOSSIP_ICON_CHAT, Acore::StringFormat("I am interested in items from the {} category.", typestring), GOSSIP_SENDER_MAIN, itemType.first + (action * 100));
-                ++i;
+                uint32 i = 1;
+                for (auto const& itemType : categoryItr->second)
+                {
+                    std::string typestring = sZoneDifficulty->GetItemTypeString(itemType.first);
+                    auto icon = snapshot.ItemIcons.find(i);
+                    if (icon != snapshot.ItemIcons.end())
+                        AddGossipItemFor(player, GOSSIP_ICON_CHAT, Acore::StringFormat("{} I am interested in items from the {} category.", icon->second, typestring), GOSSIP_SENDER_MAIN, itemType.first + (action * 100));
+                    else
+                        AddGossipItemFor(player, GOSSIP_ICON_CHAT, Acore::StringFormat("I am interested in items from the {} category.", typestring), GOSSIP_SENDER_MAIN, itemType.first + (action * 100));
+                    ++i;
+                }
             }
         }
         // Number is too low... ALWAYS remember to check if the number is too low when adding new bracket. Else enjoy crash <3
@@ -743,12 +774,13 @@ public:
                 return true;
             }
 
-            for (size_t i = 0; i < sZoneDifficulty->Rewards[category][counter].size(); ++i)
+            std::vector<ZoneDifficultyRewardData> const* rewards = sZoneDifficulty->GetSnapshot().GetRewards(category, counter);
+            for (size_t i = 0; rewards && i < rewards->size(); ++i)
             {
-                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Adding gossip option for entry {}", sZoneDifficulty->Rewards[category][counter][i].Entry);
-                ItemTemplate const* proto = sObjectMgr->GetItemTemplate(sZoneDifficulty->Rewards[category][counter][i].Entry);
+                //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Adding gossip option for entry {}", (*rewards)[i].Entry);
+                ItemTemplate const* proto = sObjectMgr->GetItemTemplate((*rewards)[i].Entry);
                 std::string name = proto->Name1;
-                if (ItemLocale const* leftIl = sObjectMgr->GetItemLocale(sZoneDifficulty->Rewards[category][counter][i].Entry))
+                if (ItemLocale const* leftIl = sObjectMgr->GetItemLocale((*rewards)[i].Entry))
                     ObjectMgr::GetLocaleString(leftIl->Name, player->GetSession()->GetSessionDbcLocale(), name);
 
                 AddGossipItemFor(player, GOSSIP_ICON_MONEY_BAG, name, GOSSIP_SENDER_MAIN, (1000 * category) + (100 * counter) + i);
@@ -779,14 +811,21 @@ public:
                 return true;
             }
 
-            uint32 availableScore = player->GetPlayerSetting(ModZoneDifficultyString + "score", category).value;
+            ZoneDifficultyRewardData const* reward = sZoneDifficulty->GetSnapshot().GetReward(category, itemType, counter);
+            if (!reward)
+            {
+                CloseGossipMenuFor(player);
+                return true;
+            }
+
+            uint32 availableScore = ZoneDifficultyScoreLedger::Get(player).GetScore(category);
 
-            if (availableScore < sZoneDifficulty->Rewards[category][itemType][counter].Price)
+            if (availableScore < reward->Price)
             {
                 npcText = NPC_TEXT_DENIED;
                 SendGossipMenuFor(player, npcText, creature);
                 std::string whisper = Acore::StringFormat("I am sorry, time-traveler. This item costs {} but you only have {} {}",
-                    sZoneDifficulty->Rewards[category][itemType][counter].Price,
+                    reward->Price,
                     availableScore,
                     sZoneDifficulty->GetContentTypeString(category));
                 creature->Whisper(whisper, LANG_UNIVERSAL, player);
@@ -794,10 +833,10 @@ public:
             }
 
             npcText = NPC_TEXT_CONFIRM;
-            ItemTemplate const* proto = sObjectMgr->GetItemTemplate(sZoneDifficulty->Rewards[category][itemType][counter].Entry);
+            ItemTemplate const* proto = sObjectMgr->GetItemTemplate(reward->Entry);
             std::string name = proto->Name1;
 
-            if (ItemLocale const* leftIl = sObjectMgr->GetItemLocale(sZoneDifficulty->Rewards[category][itemType][counter].Entry))
+            if (ItemLocale const* leftIl = sObjectMgr->GetItemLocale(reward->Entry))
                 ObjectMgr::GetLocaleString(leftIl->Name, player->GetSession()->GetSessionDbcLocale(), name);
 
             AddGossipItemFor(player, GOSSIP_ICON_CHAT, "No!", GOSSIP_SENDER_MAIN, 999998);
@@ -834,7 +873,7 @@ public:
         uint32 npcText = NPC_TEXT_OFFER;
         AddGossipItemFor(player, GOSSIP_ICON_CHAT, "|TInterface\\icons\\inv_misc_questionmark:15|t Can you please remind me of my score?", GOSSIP_SENDER_MAIN, 999999);
 
-        for (auto& typedata : sZoneDifficulty->Rewards)
+        for (auto const& typedata : sZoneDifficulty->GetSnapshot().Rewards)
         {
             if (typedata.first != 0)
             {
@@ -849,8 +888,11 @@ public:
 
     static void ShowItemsInFakeVendor(Player* player, Creature* creature, uint8 category, uint8 slot)
     {
-        auto const& itemList = sZoneDifficulty->Rewards[category][slot];
+        std::vector<ZoneDifficultyRewardData> const* rewards = sZoneDifficulty->GetSnapshot().GetRewards(category, slot);
+        if (!rewards)
+            return;
 
+        auto const& itemList = *rewards;
         uint32 itemCount = itemList.size();
 
         WorldPacket data(SMSG_LIST_INVENTORY, 8 + 1 + itemCount * 8 * 4);
@@ -916,11 +958,16 @@ public:
                 if (!sZoneDifficulty->MythicmodeEnable)
                     return;
 
+                ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+                auto mapQuest = snapshot.HeroicTBCQuestMapList.find(me->GetMapId());
+                if (mapQuest == snapshot.HeroicTBCQuestMapList.end())
+                    return;
+
                 //todo: add the list for the wotlk heroic dungeons quests
-                for (auto& quest : sZoneDifficulty->DailyHeroicQuests)
+                for (uint32 quest : snapshot.DailyHeroicQuests)
                 {
                     if (sPoolMgr->IsSpawnedObject<Quest>(quest))
-                        if (sZoneDifficulty->HeroicTBCQuestMapList[me->GetMapId()] == quest)
+                        if (mapQuest->second == quest)
                         {
                             me->SetPhaseMask(1, true);
 
@@ -966,14 +1013,10 @@ public:
 
             // Forbid turning Mythicmode on ...
             // ...if a single encounter was completed on normal mode
-            if (sZoneDifficulty->MythicmodeInstanceData.find(instanceId) != sZoneDifficulty->MythicmodeInstanceData.end())
+            if (player->GetInstanceScript()->GetBossState(0) == DONE)
             {
-                if (player->GetInstanceScript()->GetBossState(0) == DONE)
-                {
-                    canTurnOn = false;
-                    creature->Whisper("I am sorry, time-traveler. You can not return to this version of the time-line anymore. You have already completed one of the lessons.", LANG_UNIVERSAL, player);
-                    sZoneDifficulty->SaveMythicmodeInstanceData(instanceId);
-                }
+                canTurnOn = false;
+                creature->Whisper("I am sorry, time-traveler. You can not return to this version of the time-line anymore. You have already completed one of the lessons.", LANG_UNIVERSAL, player);
             }
             // ... if there is an encounter in progress
             if (player->GetInstanceScript()->IsEncounterInProgress())
@@ -988,8 +1031,9 @@ public:
             if (canTurnOn)
             {
                 //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Turn on Mythicmode for id {}", instanceId);
-                sZoneDifficulty->MythicmodeInstanceData[instanceId] = true;
+                sZoneDifficulty->InstanceStates.SetMythicmode(instanceId, true);
                 sZoneDifficulty->SaveMythicmodeInstanceData(instanceId);
+                sZoneDifficulty->InstanceStates.QueueRescale(instanceId);
                 sZoneDifficulty->SendWhisperToRaid("We're switching to the challenging version of the history lesson now. (Mythic Mode)", creature, player);
             }
 
@@ -1006,8 +1050,9 @@ public:
             if (player->GetInstanceScript()->GetBossState(0) != DONE)
             {
                 //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Turn off Mythicmode for id {}", instanceId);
-                sZoneDifficulty->MythicmodeInstanceData[instanceId] = false;
+                sZoneDifficulty->InstanceStates.SetMythicmode(instanceId, false);
                 sZoneDifficulty->SaveMythicmodeInstanceData(instanceId);
+                sZoneDifficulty->InstanceStates.QueueRescale(instanceId);
                 sZoneDifficulty->SendWhisperToRaid("We're switching to the cinematic version of the history lesson now. (Normal mode)", creature, player);
                 CloseGossipMenuFor(player);
             }
@@ -1021,8 +1066,9 @@ public:
         else if (action == 102)
         {
             //LOG_INFO("module", "MOD-ZONE-DIFFICULTY: Turn off Mythicmode for id {}", instanceId);
-            sZoneDifficulty->MythicmodeInstanceData[instanceId] = false;
+            sZoneDifficulty->InstanceStates.SetMythicmode(instanceId, false);
             sZoneDifficulty->SaveMythicmodeInstanceData(instanceId);
+            sZoneDifficulty->InstanceStates.QueueRescale(instanceId);
             sZoneDifficulty->SendWhisperToRaid("We're switching to the cinematic version of the history lesson now. (Normal mode)", creature, player);
             CloseGossipMenuFor(player);
         }
@@ -1052,7 +1098,7 @@ public:
             AddGossipItemFor(player, GOSSIP_ICON_CHAT, "Please Chromie, let us re-experience how all the things really happened back then. (Mythic Mode)", GOSSIP_SENDER_MAIN, 100);
             AddGossipItemFor(player, GOSSIP_ICON_CHAT, "I think we will be fine with the cinematic version from here. (Normal mode)", GOSSIP_SENDER_MAIN, 101);
 
-            npcText = sZoneDifficulty->MythicmodeInstanceData[player->GetMap()->GetInstanceId()] ?
+            npcText = sZoneDifficulty->IsMythicmodeInstance(player->GetMap()->GetInstanceId()) ?
                 NPC_TEXT_LEADER_HARD : NPC_TEXT_LEADER_NORMAL;
         }
         else
@@ -1069,84 +1115,39 @@ class mod_zone_difficulty_allcreaturescript : public AllCreatureScript
 public:
     mod_zone_difficulty_allcreaturescript() : AllCreatureScript("mod_zone_difficulty_allcreaturescript") { }
 
-    void OnAllCreatureUpdate(Creature* creature, uint32 /*diff*/) override
+    void OnCreatureAddWorld(Creature* creature) override
     {
-        if (!sZoneDifficulty->MythicmodeEnable)
-            return;
+        sZoneDifficulty->ScaleCreatureHealth(creature, false);
+    }
 
-        // Heavily inspired by https://github.com/azerothcore/mod-autobalance/blob/1d82080237e62376b9a030502264c90b5b8f272b/src/AutoBalance.cpp
-        Map* map = creature->GetMap();
-        if (!creature || !map)
+    void OnCreatureRemoveWorld(Creature* creature) override
+    {
+        if (!sZoneDifficulty->GetSnapshot().HasMapFlag(creature->GetMapId(), MAP_FLAG_MYTHIC))
             return;
 
-        if (!map->IsRaid() && (!(map->IsHeroic() && map->IsDungeon())))
-            return;
+        sZoneDifficulty->CancelMythicAbilities(creature);
+    }
 
-        uint32 mapId = creature->GetMapId();
-        if (sZoneDifficulty->NerfInfo.find(mapId) == sZoneDifficulty->NerfInfo.end())
-            return;
+    // Called on creation and respawn, after the core reset the base health.
+    void OnCreatureSelectLevel(CreatureTemplate const* /*creatureTemplate*/, Creature* creature) override
+    {
+        sZoneDifficulty->ScaleCreatureHealth(creature, true);
+    }
 
-        if ((creature->IsHunterPet() || creature->IsPet() || creature->IsSummon()) && creature->IsControlledByPlayer())
+    // There is no hook for phase changes, so only creatures on maps with phase dependent tuning are checked per tick.
+    void OnAllCreatureUpdate(Creature* creature, uint32 /*diff*/) override
+    {
+        ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+        if (!snapshot.HasMapFlag(creature->GetMapId(), MAP_FLAG_CREATURE_SCALING))
             return;
 
-        if (!creature->IsAlive())
+        if (!sZoneDifficulty->MythicmodeEnable)
             return;
 
-        CreatureTemplate const* creatureTemplate = creature->GetCreatureTemplate();
-        //skip critters and special creatures (spell summons etc.) in instances
-        if (creatureTemplate->maxlevel <= 1)
+        if (!snapshot.HasPhasedNerf(creature->GetMapId()))
             return;
 
-        CreatureBaseStats const* origCreatureStats = sObjectMgr->GetCreatureBaseStats(creature->GetLevel(), creatureTemplate->unit_class);
-        uint32 baseHealth = origCreatureStats->GenerateHealth(creatureTemplate);
-        uint32 scaledBaseHealth = baseHealth;
-        uint32 entry = creature->GetEntry();
-
-        uint32 phaseMask = creature->GetPhaseMask();
-        int matchingPhase = sZoneDifficulty->GetLowestMatchingPhase(creature->GetMapId(), phaseMask);
-        bool isMythic = sZoneDifficulty->MythicmodeInstanceData[creature->GetMap()->GetInstanceId()];
-
-        if (sZoneDifficulty->CreatureOverrides.find(entry) == sZoneDifficulty->CreatureOverrides.end())
-        {
-            // TEMPORARY!!! It conflicts with CC normal mode tuning, dont apply trash tuning to hyjal and ssc
-            if (creature->GetMap()->GetId() == 534 || creature->GetMap()->GetId() == 548)
-                return;
-
-            // Trash mobs. Apply generic tuning.
-            if (!creature->IsDungeonBoss() && isMythic)
-                scaledBaseHealth = round(baseHealth * sZoneDifficulty->MythicmodeHpModifier);
-        }
-        else
-        {
-            float multiplier = isMythic ? sZoneDifficulty->CreatureOverrides[entry].MythicOverride
-                : sZoneDifficulty->CreatureOverrides[entry].NormalOverride;
-
-            if (!multiplier)
-                multiplier = 1.0f; // never 0
-
-            scaledBaseHealth = round(baseHealth * multiplier);
-        }
-
-        if (matchingPhase != -1)
-        {
-            float scaledHealth = scaledBaseHealth;
-            scaledHealth *= creature->GetModifierValue(UNIT_MOD_HEALTH, BASE_PCT);
-            scaledHealth += creature->GetModifierValue(UNIT_MOD_HEALTH, TOTAL_VALUE);
-            scaledHealth *= creature->GetModifierValue(UNIT_MOD_HEALTH, TOTAL_PCT);
-
-            if (creature->GetMaxHealth() == scaledHealth)
-                return;
-
-            float percent = creature->GetHealthPct();
-            creature->SetModifierValue(UNIT_MOD_HEALTH, BASE_VALUE, (float)scaledBaseHealth);
-            creature->UpdateMaxHealth();
-            if (creature->IsAlive())
-            {
-                uint32 scaledCurHealth = creature->CountPctFromMaxHealth(percent);
-                creature->SetHealth(scaledCurHealth);
-            }
-            creature->ResetPlayerDamageReq();
-        }
+        sZoneDifficulty->ScaleCreatureHealth(creature, false);
     }
 };
 
@@ -1157,15 +1158,21 @@ public:
         PLAYERHOOK_ON_MAP_CHANGED,
         PLAYERHOOK_ON_LOGIN,
         PLAYERHOOK_ON_LOGOUT,
+        PLAYERHOOK_ON_SAVE,
         PLAYERHOOK_ON_BEFORE_BUY_ITEM_FROM_VENDOR
     }) { }
 
     void OnPlayerMapChanged(Player* player) override
     {
         uint32 mapId = player->GetMapId();
-        if (sZoneDifficulty->DisallowedBuffs.find(mapId) != sZoneDifficulty->DisallowedBuffs.end())
+        ZoneDifficultySnapshot const& snapshot = sZoneDifficulty->GetSnapshot();
+        if (!snapshot.HasMapFlag(mapId, MAP_FLAG_DISALLOWED_BUFFS))
+            return;
+
+        auto itr = snapshot.DisallowedBuffs.find(mapId);
+        if (itr != snapshot.DisallowedBuffs.end())
         {
-            for (auto aura : sZoneDifficulty->DisallowedBuffs[mapId])
+            for (uint32 aura : itr->second)
             {
                 player->RemoveAura(aura);
             }
@@ -1174,10 +1181,9 @@ public:
 
     void OnPlayerLogin(Player* player) override
     {
-        if (sZoneDifficulty->MythicmodeScore.empty())
-            return;
+        sZoneDifficulty->Progress.Load(player->GetGUID().GetCounter());
 
-        if (sZoneDifficulty->MythicmodeScore.find(player->GetGUID().GetCounter()) != sZoneDifficulty->MythicmodeScore.end())
+        if (!sZoneDifficulty->MythicmodeScore.empty() && sZoneDifficulty->MythicmodeScore.find(player->GetGUID().GetCounter()) != sZoneDifficulty->MythicmodeScore.end())
         {
             for (int i = 1; i <= 16; ++i)
             {
@@ -1186,17 +1192,27 @@ public:
                 if (sZoneDifficulty->MythicmodeScore[player->GetGUID().GetCounter()].find(i) != sZoneDifficulty->MythicmodeScore[player->GetGUID().GetCounter()].end())
                     availableScore = sZoneDifficulty->MythicmodeScore[player->GetGUID().GetCounter()][i];
 
-                player->UpdatePlayerSetting(ModZoneDifficultyString + "score", i, availableScore);
+                player->UpdatePlayerSetting(ModZoneDifficultyScoreSetting, i, availableScore);
             }
 
             sZoneDifficulty->MythicmodeScore.erase(player->GetGUID().GetCounter());
             CharacterDatabase.Execute("DELETE FROM zone_difficulty_mythicmode_score WHERE GUID = {}", player->GetGUID().GetCounter());
         }
+
+        // After the migration above, which still writes into the player settings
+        ZoneDifficultyScoreLedger::Get(player);
     }
 
     void OnPlayerLogout(Player* player) override
     {
         sZoneDifficulty->SelectionCache.erase(player->GetGUID());
+        sZoneDifficulty->Progress.Evict(player->GetGUID().GetCounter());
+        ZoneDifficultyScoreLedger::Save(player, true);
+    }
+
+    void OnPlayerSave(Player* player) override
+    {
+        ZoneDifficultyScoreLedger::Save(player, false);
     }
 
     void OnPlayerBeforeBuyItemFromVendor(Player* player, ObjectGuid vendorguid, uint32 /*vendorslot*/, uint32& itemEntry, uint8 /*count*/, uint8 /*bag*/, uint8 /*slot*/) override
@@ -1221,6 +1237,7 @@ void AddModZoneDifficultyScripts()
     new mod_zone_difficulty_unitscript();
     new mod_zone_difficulty_petscript();
     new mod_zone_difficulty_worldscript();
+    new mod_zone_difficulty_allmapscript();
     new mod_zone_difficulty_globalscript();
     new mod_zone_difficulty_rewardnpc();
     new mod_zone_difficulty_dungeonmaster();
@@ -0,0 +1,521 @@
+#include "MythicmodeSql.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    std::string const TABLE_NAME = "zone_difficulty_mythicmode_ai";
+
+    std::string ToLower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    }
+
+    bool IsWordChar(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+    }
+}
+
+bool MythicmodeSqlLoader::LoadDirectory(std::string const& directory)
+{
+    std::error_code error;
+    std::vector<std::filesystem::path> files;
+    for (auto const& file : std::filesystem::directory_iterator(directory, error))
+        if (file.is_regular_file() && file.path().extension() == ".sql")
+            files.push_back(file.path());
+
+    if (error)
+    {
+        Errors.push_back(directory + ": " + error.message());
+        return false;
+    }
+
+    std::sort(files.begin(), files.end());
+    for (auto const& file : files)
+        LoadFile(file.string());
+
+    return true;
+}
+
+bool MythicmodeSqlLoader::LoadFile(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        Errors.push_back(path + ": can not be opened");
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    std::vector<std::vector<Token> > statements;
+    std::string error;
+    if (!Tokenize(buffer.str(), statements, error))
+    {
+        Errors.push_back(path + ": " + error);
+        return false;
+    }
+
+    std::string source = std::filesystem::path(path).filename().string();
+    for (auto const& statement : statements)
+        ApplyStatement(statement, source);
+
+    return true;
+}
+
+/**
+ *  @brief Split a SQL script into statements of tokens. Comments and whitespace are dropped.
+ */
+bool MythicmodeSqlLoader::Tokenize(std::string const& text, std::vector<std::vector<Token> >& statements, std::string& error)
+{
+    std::vector<Token> current;
+    std::size_t line = 1;
+
+    for (std::size_t i = 0; i < text.size();)
+    {
+        char c = text[i];
+
+        if (c == '\n')
+            ++line;
+
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            ++i;
+            continue;
+        }
+
+        // -- comment, # comment and /* comment */
+        if ((c == '-' && i + 1 < text.size() && text[i + 1] == '-' && (i + 2 >= text.size() || std::isspace(static_cast<unsigned char>(text[i + 2])))) || c == '#')
+        {
+            while (i < text.size() && text[i] != '\n')
+                ++i;
+            continue;
+        }
+
+        if (c == '/' && i + 1 < text.size() && text[i + 1] == '*')
+        {
+            std::size_t end = text.find("*/", i + 2);
+            if (end == std::string::npos)
+            {
+                error = "unterminated comment in line " + std::to_string(line);
+                return false;
+            }
+
+            line += std::count(text.begin() + i, text.begin() + end, '\n');
+            i = end + 2;
+            continue;
+        }
+
+        if (c == ';')
+        {
+            if (!current.empty())
+                statements.push_back(std::move(current));
+            current.clear();
+            ++i;
+            continue;
+        }
+
+        Token token;
+        if (c == '\'' || c == '"' || c == '`')
+        {
+            token.Type = c == '`' ? Token::IDENTIFIER : Token::STRING;
+            std::size_t start = line;
+            ++i;
+            while (i < text.size() && text[i] != c)
+            {
+                if (text[i] == '\\' && i + 1 < text.size() && c != '`')
+                    ++i;
+                else if (text[i] == '\n')
+                    ++line;
+
+                token.Text += text[i++];
+            }
+
+            if (i >= text.size())
+            {
+                error = "unterminated quote starting in line " + std::to_string(start);
+                return false;
+            }
+
+            ++i;
+            if (token.Type == Token::IDENTIFIER)
+                token.Text = ToLower(token.Text);
+        }
+        else if (c == '@')
+        {
+            token.Type = Token::VARIABLE;
+            ++i;
+            while (i < text.size() && IsWordChar(text[i]))
+                token.Text += text[i++];
+            token.Text = ToLower(token.Text);
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)))
+        {
+            token.Type = Token::NUMBER;
+            while (i < text.size() && IsWordChar(text[i]))
+                token.Text += text[i++];
+        }
+        else if (IsWordChar(c))
+        {
+            token.Type = Token::WORD;
+            while (i < text.size() && IsWordChar(text[i]))
+                token.Text += text[i++];
+            token.Text = ToLower(token.Text);
+        }
+        else
+        {
+            token.Type = Token::SYMBOL;
+            token.Text = c;
+            ++i;
+        }
+
+        current.push_back(std::move(token));
+    }
+
+    if (!current.empty())
+        statements.push_back(std::move(current));
+
+    return true;
+}
+
+bool MythicmodeSqlLoader::ReadValue(std::vector<Token> const& tokens, std::size_t& pos, Value& value) const
+{
+    if (pos >= tokens.size())
+        return false;
+
+    bool negative = false;
+    if (tokens[pos].Type == Token::SYMBOL && tokens[pos].Text == "-")
+    {
+        negative = true;
+        ++pos;
+        if (pos >= tokens.size())
+            return false;
+    }
+
+    Token const& token = tokens[pos++];
+    value = Value();
+    switch (token.Type)
+    {
+        case Token::NUMBER:
+            try
+            {
+                value.Number = token.Text.find('.') != std::string::npos ? int64_t(std::stod(token.Text)) : std::stoll(token.Text);
+            }
+            catch (std::exception const&)
+            {
+                return false;
+            }
+            break;
+        case Token::VARIABLE:
+        {
+            auto itr = _variables.find(token.Text);
+            if (itr == _variables.end())
+                return false;
+            value.Number = itr->second;
+            break;
+        }
+        case Token::STRING:
+            value.IsString = true;
+            value.Text = token.Text;
+            break;
+        case Token::WORD:
+            if (token.Text == "null")
+                value.IsNull = true;
+            else if (token.Text == "true" || token.Text == "false")
+                value.Number = token.Text == "true";
+            else
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    if (negative)
+        value.Number = -value.Number;
+
+    return true;
+}
+
+bool MythicmodeSqlLoader::AssignColumn(MythicmodeSqlRow& row, std::string const& column, Value const& value) const
+{
+    int64_t number = value.Number;
+    if (value.IsString && column != "comment")
+    {
+        try
+        {
+            number = std::stoll(value.Text);
+        }
+        catch (std::exception const&)
+        {
+            return false;
+        }
+    }
+
+    if (column == "creatureentry")
+        row.CreatureEntry = uint32_t(number);
+    else if (column == "chance")
+        row.Chance = number;
+    else if (column == "spell")
+        row.Spell = uint32_t(number);
+    else if (column == "spellbp0")
+        row.Spellbp[0] = int32_t(number);
+    else if (column == "spellbp1")
+        row.Spellbp[1] = int32_t(number);
+    else if (column == "spellbp2")
+        row.Spellbp[2] = int32_t(number);
+    else if (column == "target")
+        row.Target = number;
+    else if (column == "targetarg")
+        row.TargetArg = number;
+    else if (column == "targetarg2")
+        row.TargetArg2 = number;
+    else if (column == "delay")
+        row.Delay = number;
+    else if (column == "cooldown")
+        row.Cooldown = number;
+    else if (column == "repetitions")
+        row.Repetitions = number;
+    else if (column == "enabled")
+        row.Enabled = number != 0;
+    else if (column == "triggeredcast")
+        row.TriggeredCast = number != 0;
+    else if (column == "priority")
+        row.Priority = number;
+    else if (column == "comment")
+        row.Comment = value.IsNull ? std::string() : value.Text;
+    else
+        return false;
+
+    return true;
+}
+
+void MythicmodeSqlLoader::ApplyStatement(std::vector<Token> const& tokens, std::string const& source)
+{
+    auto isWord = [&tokens](std::size_t pos, char const* word)
+    {
+        return pos < tokens.size() && tokens[pos].Type == Token::WORD && tokens[pos].Text == word;
+    };
+    auto isSymbol = [&tokens](std::size_t pos, char const* symbol)
+    {
+        return pos < tokens.size() && tokens[pos].Type == Token::SYMBOL && tokens[pos].Text == symbol;
+    };
+    auto isTable = [&tokens](std::size_t pos)
+    {
+        return pos < tokens.size() && (tokens[pos].Type == Token::IDENTIFIER || tokens[pos].Type == Token::WORD) && tokens[pos].Text == TABLE_NAME;
+    };
+    auto fail = [this, &source](std::string const& message)
+    {
+        Errors.push_back(source + ": " + message);
+    };
+
+    std::size_t pos = 0;
+
+    if (isWord(0, "set"))
+    {
+        for (pos = 1; pos < tokens.size(); ++pos)
+        {
+            if (tokens[pos].Type != Token::VARIABLE || !isSymbol(pos + 1, "="))
+                return;
+
+            std::string name = tokens[pos].Text;
+            pos += 2;
+            Value value;
+            if (!ReadValue(tokens, pos, value) || value.IsString)
+            {
+                fail("can not evaluate SET @" + name);
+                return;
+            }
+
+            _variables[name] = value.Number;
+            if (!isSymbol(pos, ","))
+                return;
+        }
+        return;
+    }
+
+    if (isWord(0, "drop") && isWord(1, "table"))
+    {
+        pos = isWord(2, "if") ? 4 : 2;
+        if (isTable(pos))
+        {
+            Rows.clear();
+            _columns.clear();
+            _defaults.clear();
+        }
+        return;
+    }
+
+    if (isWord(0, "create") && isWord(1, "table"))
+    {
+        pos = isWord(2, "if") ? 5 : 2;
+        if (!isTable(pos) || !isSymbol(pos + 1, "("))
+            return;
+
+        Rows.clear();
+        _columns.clear();
+        _defaults.clear();
+
+        // Walk the column definitions, a new one starts after every comma on the top level
+        int32_t depth = 1;
+        bool expectColumn = true;
+        std::string column;
+        for (pos += 2; pos < tokens.size() && depth > 0; ++pos)
+        {
+            Token const& token = tokens[pos];
+            if (token.Type == Token::SYMBOL && token.Text == "(")
+                ++depth;
+            else if (token.Type == Token::SYMBOL && token.Text == ")")
+                --depth;
+            else if (depth == 1 && token.Type == Token::SYMBOL && token.Text == ",")
+                expectColumn = true;
+            else if (expectColumn)
+            {
+                expectColumn = false;
+                column.clear();
+                if (token.Type == Token::IDENTIFIER || (token.Type == Token::WORD && token.Text != "primary" && token.Text != "key" && token.Text != "index" && token.Text != "unique"))
+                {
+                    column = token.Text;
+                    _columns.push_back(column);
+                }
+            }
+            else if (depth == 1 && !column.empty() && token.Type == Token::WORD && token.Text == "default")
+            {
+                std::size_t valuePos = pos + 1;
+                Value value;
+                if (ReadValue(tokens, valuePos, value))
+                    _defaults[column] = value;
+                pos = valuePos - 1;
+            }
+        }
+        return;
+    }
+
+    if (isWord(0, "delete") && isWord(1, "from"))
+    {
+        if (!isTable(2))
+            return;
+
+        pos = 3;
+        if (pos >= tokens.size())
+        {
+            Rows.clear();
+            return;
+        }
+
+        if (!isWord(pos, "where") || pos + 1 >= tokens.size() || ToLower(tokens[pos + 1].Text) != "creatureentry")
+        {
+            fail("only DELETE ... WHERE CreatureEntry IN (...) / = x is supported");
+            return;
+        }
+
+        std::vector<uint32_t> entries;
+        pos += 2;
+        if (isSymbol(pos, "="))
+        {
+            ++pos;
+            Value value;
+            if (!ReadValue(tokens, pos, value))
+            {
+                fail("can not evaluate the CreatureEntry of a DELETE");
+                return;
+            }
+            entries.push_back(uint32_t(value.Number));
+        }
+        else if (isWord(pos, "in") && isSymbol(pos + 1, "("))
+        {
+            for (pos += 2; pos < tokens.size() && !isSymbol(pos, ")");)
+            {
+                Value value;
+                if (!ReadValue(tokens, pos, value))
+                {
+                    fail("can not evaluate the CreatureEntry list of a DELETE");
+                    return;
+                }
+                entries.push_back(uint32_t(value.Number));
+                if (isSymbol(pos, ","))
+                    ++pos;
+            }
+        }
+        else
+        {
+            fail("only DELETE ... WHERE CreatureEntry IN (...) / = x is supported");
+            return;
+        }
+
+        std::erase_if(Rows, [&entries](MythicmodeSqlRow const& row)
+        {
+            return std::find(entries.begin(), entries.end(), row.CreatureEntry) != entries.end();
+        });
+        return;
+    }
+
+    if (isWord(0, "insert") || isWord(0, "replace"))
+    {
+        pos = isWord(1, "into") ? 2 : 1;
+        if (!isTable(pos))
+            return;
+
+        std::vector<std::string> columns;
+        ++pos;
+        if (isSymbol(pos, "("))
+        {
+            for (++pos; pos < tokens.size() && !isSymbol(pos, ")"); ++pos)
+                if (tokens[pos].Type == Token::IDENTIFIER || tokens[pos].Type == Token::WORD)
+                    columns.push_back(ToLower(tokens[pos].Text));
+            ++pos;
+        }
+        else
+            columns = _columns;
+
+        if (!isWord(pos, "values"))
+        {
+            fail("INSERT without VALUES is not supported");
+            return;
+        }
+
+        for (++pos; pos < tokens.size();)
+        {
+            if (!isSymbol(pos, "("))
+            {
+                fail("malformed VALUES list");
+                return;
+            }
+
+            MythicmodeSqlRow row;
+            for (auto const& [column, value] : _defaults)
+                AssignColumn(row, column, value);
+            row.Source = source;
+
+            ++pos;
+            for (std::size_t i = 0; pos < tokens.size() && !isSymbol(pos, ")"); ++i)
+            {
+                Value value;
+                if (!ReadValue(tokens, pos, value))
+                {
+                    fail("can not evaluate value " + std::to_string(i + 1) + " of row " + std::to_string(Rows.size() + 1));
+                    return;
+                }
+
+                if (i >= columns.size() || !AssignColumn(row, columns[i], value))
+                {
+                    fail("value " + std::to_string(i + 1) + " has no matching column");
+                    return;
+                }
+
+                if (isSymbol(pos, ","))
+                    ++pos;
+            }
+
+            Rows.push_back(std::move(row));
+            ++pos;
+            if (isSymbol(pos, ","))
+                ++pos;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef DEF_MYTHICMODE_SIM_SQL_H
+#define DEF_MYTHICMODE_SIM_SQL_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ *  @brief A row of zone_difficulty_mythicmode_ai, as the SQL files would leave it in the database.
+ */
+struct MythicmodeSqlRow
+{
+    uint32_t CreatureEntry = 0;
+    int64_t Chance = 100;
+    uint32_t Spell = 0;
+    int32_t Spellbp[3] = { 0, 0, 0 };
+    int64_t Target = 1;
+    int64_t TargetArg = 0;
+    int64_t TargetArg2 = 0;
+    int64_t Delay = 1;
+    int64_t Cooldown = 1;
+    int64_t Repetitions = 0;
+    bool Enabled = true;
+    bool TriggeredCast = true;
+    int64_t Priority = 0;
+    std::string Comment;
+    std::string Source;     // file the row was inserted by
+};
+
+/**
+ *  @brief Replays the SQL files of data/sql/db-world on a tiny in-memory zone_difficulty_mythicmode_ai.
+ *
+ *  Understands what the module's files use on that table: SET of @variables, DROP/CREATE TABLE
+ *  (column defaults are taken from the CREATE), DELETE ... WHERE CreatureEntry IN (...) / = x and
+ *  INSERT/REPLACE INTO with a column list. Statements on other tables are skipped.
+ */
+class MythicmodeSqlLoader
+{
+public:
+    /**
+     *  @brief Apply every *.sql file of the directory in file name order, like the DB updater does.
+     *  @return false if the directory can not be read. Parse errors are collected in Errors.
+     */
+    bool LoadDirectory(std::string const& directory);
+    bool LoadFile(std::string const& path);
+
+    std::vector<MythicmodeSqlRow> Rows;
+    std::vector<std::string> Errors;
+
+private:
+    struct Token
+    {
+        enum Kind { WORD, IDENTIFIER, NUMBER, STRING, VARIABLE, SYMBOL } Type = WORD;
+        std::string Text;   // WORD is lower case, IDENTIFIER has the backticks removed
+    };
+
+    struct Value
+    {
+        bool IsNull = false;
+        bool IsString = false;
+        int64_t Number = 0;
+        std::string Text;
+    };
+
+    static bool Tokenize(std::string const& text, std::vector<std::vector<Token> >& statements, std::string& error);
+
+    void ApplyStatement(std::vector<Token> const& tokens, std::string const& source);
+    bool ReadValue(std::vector<Token> const& tokens, std::size_t& pos, Value& value) const;
+    bool AssignColumn(MythicmodeSqlRow& row, std::string const& column, Value const& value) const;
+
+    std::map<std::string, int64_t> _variables;
+    std::vector<std::string> _columns;              // column order of the last CREATE TABLE
+    std::map<std::string, Value> _defaults;         // column -> DEFAULT of the last CREATE TABLE
+};
+
+#endif
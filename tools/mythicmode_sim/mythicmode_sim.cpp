@@ -0,0 +1,784 @@
+/*
+ * Offline simulator for zone_difficulty_mythicmode_ai.
+ *
+ * Loads the rows from the module's SQL files, compiles them with the rules of the worldserver loader
+ * and runs encounters against fake units and raids. Scheduling goes through the same
+ * ZoneDifficultyTimingWheel as in game, firing follows MythicmodeEvent: Chance is rolled on
+ * entering combat, the first cast comes after Delay, Repetitions 0 repeats after Cooldown and
+ * abilities due while the unit is casting wait until the cast is over.
+ */
+
+#include "MythicmodeSql.h"
+#include "ZoneDifficultyTargetSnapshot.h"
+#include "ZoneDifficultyTimingWheel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef MYTHICMODE_SIM_SQL_DIR
+#define MYTHICMODE_SIM_SQL_DIR "data/sql/db-world"
+#endif
+
+namespace
+{
+    // Target types, see ZoneDifficulty.h
+    uint32_t const TARGET_NONE = 0;
+    uint32_t const TARGET_SELF = 1;
+    uint32_t const TARGET_VICTIM = 2;
+    uint32_t const TARGET_HOSTILE_AGGRO_FROM_TOP = 3;
+    uint32_t const TARGET_HOSTILE_AGGRO_FROM_BOTTOM = 4;
+    uint32_t const TARGET_HOSTILE_RANDOM = 5;
+    uint32_t const TARGET_HOSTILE_RANDOM_NOT_TOP = 6;
+    uint32_t const TARGET_PLAYER_DISTANCE = 18;
+    uint32_t const TARGET_PLAYER_DENSEST_CLUSTER = 19;
+    uint32_t const TARGET_PLAYER_MOST_ALLIES = 20;
+
+    uint32_t const MAX_RAID_SIZE = 128;
+    float const COMBAT_REACH = 1.5f;            // default combat reach of players and creatures
+    float const MAX_VISIBILITY_DISTANCE = 250.0f;
+
+    struct Options
+    {
+        std::string SqlDir = MYTHICMODE_SIM_SQL_DIR;
+        std::vector<uint32_t> Entries;
+        uint32_t Units = 0;             // 0 = one per entry
+        uint32_t UnitsPerInstance = 1;
+        uint32_t RaidSize = 25;
+        uint32_t DurationMs = 300000;
+        uint32_t Pulls = 1;
+        uint32_t UpdateMs = 10;
+        uint32_t CastMs = 1500;
+        uint32_t BossCastMs = 0;
+        uint32_t BossCastEveryMs = 0;
+        float Spread = 30.0f;
+        uint32_t MoveMs = 2000;
+        uint32_t Seed = 1;
+        bool Quiet = false;
+        bool List = false;
+    };
+
+    // What the worldserver loader compiles a row into, minus the spell store parts
+    struct SimAbility
+    {
+        MythicmodeSqlRow const* Row = nullptr;
+        uint32_t Chance = 0;
+        uint32_t Target = 0;
+        uint64_t Delay = 0;
+        uint64_t Cooldown = 0;
+        bool Repeat = false;
+        bool Triggered = false;
+        uint8_t Priority = 0;
+        float SelectRange = 0.0f;
+        uint8_t ThreatPosition = 0;
+        float Radius = 0.0f;
+        bool Fallback = false;
+        float MinRange = 0.0f;
+        float MaxRange = 0.0f;
+    };
+
+    struct AbilityStats
+    {
+        uint64_t Fires = 0;
+        uint64_t Casts = 0;
+        uint64_t NoTarget = 0;
+        uint64_t Parked = 0;
+    };
+
+    struct Payload
+    {
+        uint32_t Unit = 0;
+        uint32_t Index = 0;
+        uint32_t Generation = 0;
+        uint8_t Priority = 0;
+    };
+
+    typedef ZoneDifficultyTimingWheel<Payload> Wheel;
+
+    struct Player
+    {
+        float X = 0.0f;
+        float Y = 0.0f;
+        float Z = 0.0f;
+    };
+
+    struct Unit
+    {
+        uint32_t Entry = 0;
+        uint32_t Instance = 0;
+        std::vector<SimAbility> const* Program = nullptr;
+        std::vector<AbilityStats>* Stats = nullptr;
+        uint32_t Generation = 0;
+        std::vector<Wheel::Handle> Slots;
+        std::vector<Payload> Parked;
+        uint64_t CastEndMs = 0;
+        uint64_t NextBossCastMs = 0;
+        uint64_t NextMoveMs = 0;
+        std::vector<Player> Raid;
+        ZoneDifficultyTargetSnapshot<uint32_t, MAX_RAID_SIZE> Targets;
+    };
+
+    struct Instance
+    {
+        Wheel AbilityWheel;
+        std::vector<uint32_t> Units;
+        std::vector<uint32_t> ParkedUnits;
+        std::vector<Payload> Due;
+    };
+
+    struct SchedulerStats
+    {
+        uint64_t Scheduled = 0;
+        uint64_t Fired = 0;
+        uint64_t Cancelled = 0;
+        uint64_t Parked = 0;
+        uint64_t Stale = 0;
+        uint64_t Updates = 0;
+        std::size_t PeakPending = 0;
+    };
+
+    /**
+     *  @brief Mirror of CompileMythicAbility in mod_zone_difficulty_handler.cpp. Spells and creatures can not be checked offline.
+     */
+    bool Compile(MythicmodeSqlRow const& row, SimAbility& ability, std::string& error)
+    {
+        if (row.Chance <= 0 || row.Chance > 100)
+        {
+            error = "`Chance` " + std::to_string(row.Chance) + " outside of 1-100";
+            return false;
+        }
+
+        if (!row.Spell)
+        {
+            error = "`Spell` is 0";
+            return false;
+        }
+
+        int8_t targetArg = int8_t(row.TargetArg);
+        uint8_t targetArg2 = uint8_t(row.TargetArg2);
+
+        ability.Row = &row;
+        ability.Chance = uint32_t(row.Chance);
+        ability.Target = uint32_t(row.Target);
+        ability.Delay = uint64_t(std::max<int64_t>(row.Delay, 0));
+        ability.Cooldown = uint64_t(std::max<int64_t>(row.Cooldown, 0));
+        ability.Triggered = row.TriggeredCast;
+        ability.Priority = uint8_t(row.Priority);
+
+        switch (ability.Target)
+        {
+            case TARGET_NONE:
+            case TARGET_SELF:
+            case TARGET_VICTIM:
+                break;
+            case TARGET_HOSTILE_AGGRO_FROM_TOP:
+                ability.SelectRange = targetArg > 0 ? targetArg : 200.0f;
+                ability.ThreatPosition = targetArg2;
+                break;
+            case TARGET_HOSTILE_AGGRO_FROM_BOTTOM:
+                if (targetArg < 0)
+                {
+                    error = "negative threat position in `TargetArg`";
+                    return false;
+                }
+
+                ability.SelectRange = targetArg2 > 0 ? targetArg2 : 200.0f;
+                ability.ThreatPosition = targetArg;
+                break;
+            case TARGET_HOSTILE_RANDOM:
+            case TARGET_HOSTILE_RANDOM_NOT_TOP:
+                ability.SelectRange = targetArg;
+                break;
+            case TARGET_PLAYER_DENSEST_CLUSTER:
+            case TARGET_PLAYER_MOST_ALLIES:
+                if (!targetArg2)
+                {
+                    error = "no cluster radius in `TargetArg2`";
+                    return false;
+                }
+
+                ability.SelectRange = targetArg > 0 ? targetArg : 200.0f;
+                ability.Radius = targetArg2;
+                break;
+            case TARGET_PLAYER_DISTANCE:
+                if (targetArg < 0)
+                {
+                    error = "negative distance in `TargetArg`";
+                    return false;
+                }
+
+                ability.SelectRange = targetArg;
+                break;
+            default:
+                error = "unknown `Target` " + std::to_string(row.Target);
+                return false;
+        }
+
+        if (!row.Repetitions)
+        {
+            if (row.Cooldown <= 0)
+            {
+                error = "repeats without a `Cooldown`";
+                return false;
+            }
+
+            ability.Repeat = true;
+        }
+
+        if (ability.Target != TARGET_NONE && targetArg)
+        {
+            ability.Fallback = true;
+            ability.MinRange = targetArg > 0 ? 0.0f : -targetArg;
+            ability.MaxRange = targetArg > 0 ? targetArg : MAX_VISIBILITY_DISTANCE;
+        }
+
+        return true;
+    }
+
+    class Simulator
+    {
+    public:
+        Simulator(Options const& options, std::map<uint32_t, std::vector<SimAbility> > const& programs) : _options(options), _programs(programs), _random(options.Seed) { }
+
+        void Run();
+        void Report() const;
+
+    private:
+        void SetupUnits();
+        void EnterCombat(uint32_t unitIndex, uint64_t now);
+        void Evade(uint32_t unitIndex);
+        void Schedule(uint32_t unitIndex, uint32_t index, uint64_t dueMs);
+        void Update(Instance& instance, uint64_t now);
+        void Fire(Instance& instance, std::vector<Payload>& due, uint64_t now);
+        void Event(Instance& instance, Payload const& payload, uint64_t now);
+        uint32_t ResolveCasts(Unit& unit, SimAbility const& ability, uint64_t now);
+        void MoveRaid(Unit& unit);
+        bool Roll(uint32_t chance) { return chance == 100 || chance >= std::uniform_int_distribution<uint32_t>(1, 100)(_random); }
+
+        Options const& _options;
+        std::map<uint32_t, std::vector<SimAbility> > const& _programs;
+        std::map<uint32_t, std::vector<AbilityStats> > _stats;
+        std::map<uint32_t, uint32_t> _unitsPerEntry;
+        std::vector<Unit> _units;
+        std::vector<Instance> _instances;
+        SchedulerStats _scheduler;
+        std::mt19937 _random;
+        double _wallSeconds = 0.0;
+        ZoneDifficultyCandidateSet<MAX_RAID_SIZE> _candidates;
+        ZoneDifficultyTargetGrid<MAX_RAID_SIZE> _grid;
+    };
+
+    void Simulator::SetupUnits()
+    {
+        std::vector<uint32_t> entries = _options.Entries;
+        if (entries.empty())
+            for (auto const& [entry, program] : _programs)
+                entries.push_back(entry);
+
+        uint32_t unitCount = _options.Units ? _options.Units : uint32_t(entries.size());
+        uint32_t perInstance = std::max<uint32_t>(_options.UnitsPerInstance, 1);
+
+        _units.resize(unitCount);
+        _instances.resize((unitCount + perInstance - 1) / perInstance);
+
+        for (uint32_t i = 0; i < unitCount; ++i)
+        {
+            Unit& unit = _units[i];
+            unit.Entry = entries[i % entries.size()];
+            unit.Instance = i / perInstance;
+            unit.Program = &_programs.at(unit.Entry);
+            std::vector<AbilityStats>& stats = _stats[unit.Entry];
+            stats.resize(unit.Program->size());
+            unit.Stats = &stats;
+            unit.Raid.resize(_options.RaidSize);
+            ++_unitsPerEntry[unit.Entry];
+            _instances[unit.Instance].Units.push_back(i);
+        }
+    }
+
+    void Simulator::MoveRaid(Unit& unit)
+    {
+        std::uniform_real_distribution<float> unitRange(0.0f, 1.0f);
+        unit.Targets.Clear();
+
+        for (uint32_t i = 0; i < unit.Raid.size(); ++i)
+        {
+            Player& player = unit.Raid[i];
+            if (!i)
+            {
+                // The tank stays in front of the unit
+                player = { 2.0f, 0.0f, 0.0f };
+            }
+            else
+            {
+                float distance = _options.Spread * std::sqrt(unitRange(_random));
+                float angle = 6.2831853f * unitRange(_random);
+                player = { distance * std::cos(angle), distance * std::sin(angle), 0.0f };
+            }
+
+            unit.Targets.Add(i, player.X, player.Y, player.Z, COMBAT_REACH);
+        }
+    }
+
+    void Simulator::Schedule(uint32_t unitIndex, uint32_t index, uint64_t dueMs)
+    {
+        Unit& unit = _units[unitIndex];
+        Instance& instance = _instances[unit.Instance];
+
+        Payload payload;
+        payload.Unit = unitIndex;
+        payload.Index = index;
+        payload.Generation = unit.Generation;
+        payload.Priority = (*unit.Program)[index].Priority;
+
+        if (unit.Slots.size() <= index)
+            unit.Slots.resize(index + 1);
+
+        if (instance.AbilityWheel.Cancel(unit.Slots[index]))
+            ++_scheduler.Cancelled;
+
+        unit.Slots[index] = instance.AbilityWheel.Schedule(payload, dueMs);
+        ++_scheduler.Scheduled;
+        _scheduler.PeakPending = std::max(_scheduler.PeakPending, instance.AbilityWheel.Size());
+    }
+
+    void Simulator::EnterCombat(uint32_t unitIndex, uint64_t now)
+    {
+        Unit& unit = _units[unitIndex];
+        Evade(unitIndex);
+        unit.CastEndMs = 0;
+        unit.NextBossCastMs = now + _options.BossCastEveryMs;
+        unit.NextMoveMs = now;
+
+        for (uint32_t i = 0; i < unit.Program->size(); ++i)
+            if (Roll((*unit.Program)[i].Chance))
+                Schedule(unitIndex, i, now + (*unit.Program)[i].Delay);
+    }
+
+    void Simulator::Evade(uint32_t unitIndex)
+    {
+        Unit& unit = _units[unitIndex];
+        Instance& instance = _instances[unit.Instance];
+
+        ++unit.Generation;
+        for (Wheel::Handle& handle : unit.Slots)
+        {
+            if (instance.AbilityWheel.Cancel(handle))
+                ++_scheduler.Cancelled;
+            handle = Wheel::Handle();
+        }
+
+        unit.Parked.clear();
+    }
+
+    uint32_t Simulator::ResolveCasts(Unit& unit, SimAbility const& ability, uint64_t now)
+    {
+        if (now >= unit.NextMoveMs)
+        {
+            MoveRaid(unit);
+            unit.NextMoveMs = now + std::max<uint32_t>(_options.MoveMs, 1);
+        }
+
+        uint32_t raidSize = unit.Targets.Size();
+        bool found = false;
+
+        switch (ability.Target)
+        {
+            case TARGET_NONE:
+            case TARGET_SELF:
+                return 1;
+            case TARGET_VICTIM:
+                found = raidSize > 0;
+                break;
+            case TARGET_HOSTILE_AGGRO_FROM_TOP:
+            case TARGET_HOSTILE_AGGRO_FROM_BOTTOM:
+                // Threat order is raid order, anything short of the position falls back to the victim
+                found = raidSize > 0;
+                break;
+            case TARGET_HOSTILE_RANDOM:
+            case TARGET_HOSTILE_RANDOM_NOT_TOP:
+            {
+                uint32_t skip = ability.Target == TARGET_HOSTILE_RANDOM_NOT_TOP ? 1 : 0;
+                if (ability.SelectRange > 0.0f)
+                {
+                    unit.Targets.FilterWithin(0.0f, 0.0f, 0.0f, ability.SelectRange + COMBAT_REACH, _candidates);
+                    for (uint16_t index : _candidates)
+                        found |= index >= skip;
+                }
+                else if (ability.SelectRange < 0.0f)
+                {
+                    unit.Targets.FilterWithin(0.0f, 0.0f, 0.0f, -ability.SelectRange + COMBAT_REACH, _candidates);
+                    uint32_t inside = 0;
+                    for (uint16_t index : _candidates)
+                        inside += index >= skip;
+                    found = inside < raidSize - std::min(skip, raidSize);
+                }
+                else
+                    found = raidSize > skip;
+                break;
+            }
+            case TARGET_PLAYER_DISTANCE:
+                unit.Targets.FilterWithin(0.0f, 0.0f, 0.0f, ability.SelectRange + COMBAT_REACH, _candidates);
+                return _candidates.Count;
+            case TARGET_PLAYER_DENSEST_CLUSTER:
+            case TARGET_PLAYER_MOST_ALLIES:
+            {
+                unit.Targets.FilterWithin(0.0f, 0.0f, 0.0f, ability.SelectRange + COMBAT_REACH, _candidates);
+                _grid.Build(unit.Targets, _candidates, ability.Radius);
+                uint32_t index = ability.Target == TARGET_PLAYER_DENSEST_CLUSTER ? _grid.DensestCluster() : _grid.MostNeighbors(ability.Radius);
+                found = index != _grid.NONE;
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (!found && ability.Fallback && raidSize)
+        {
+            Player const& victim = unit.Raid[0];
+            float distance = std::sqrt(victim.X * victim.X + victim.Y * victim.Y + victim.Z * victim.Z);
+            found = distance >= ability.MinRange && distance <= ability.MaxRange;
+        }
+
+        return found ? 1 : 0;
+    }
+
+    /**
+     *  @brief MythicmodeEvent on a fake unit.
+     */
+    void Simulator::Event(Instance& instance, Payload const& payload, uint64_t now)
+    {
+        Unit& unit = _units[payload.Unit];
+        SimAbility const& ability = (*unit.Program)[payload.Index];
+        AbilityStats& stats = (*unit.Stats)[payload.Index];
+
+        if (now < unit.CastEndMs)
+        {
+            if (unit.Parked.empty())
+                instance.ParkedUnits.push_back(payload.Unit);
+
+            unit.Parked.push_back(payload);
+            ++stats.Parked;
+            ++_scheduler.Parked;
+            return;
+        }
+
+        if (ability.Repeat)
+            Schedule(payload.Unit, payload.Index, now + ability.Cooldown);
+
+        ++stats.Fires;
+        uint32_t casts = ResolveCasts(unit, ability, now);
+        if (!casts)
+        {
+            ++stats.NoTarget;
+            return;
+        }
+
+        stats.Casts += casts;
+        if (!ability.Triggered)
+            unit.CastEndMs = now + _options.CastMs;
+    }
+
+    void Simulator::Fire(Instance& instance, std::vector<Payload>& due, uint64_t now)
+    {
+        std::sort(due.begin(), due.end(), [](Payload const& left, Payload const& right)
+        {
+            if (left.Unit != right.Unit)
+                return left.Unit < right.Unit;
+
+            if (left.Priority != right.Priority)
+                return left.Priority > right.Priority;
+
+            return left.Index < right.Index;
+        });
+
+        for (Payload const& payload : due)
+        {
+            if (_units[payload.Unit].Generation != payload.Generation)
+            {
+                ++_scheduler.Stale;
+                continue;
+            }
+
+            Event(instance, payload, now);
+        }
+    }
+
+    /**
+     *  @brief UpdateMythicAbilities of one instance.
+     */
+    void Simulator::Update(Instance& instance, uint64_t now)
+    {
+        // The scripted spells of the units, which block the Mythicmode AI like any other cast
+        if (_options.BossCastEveryMs && _options.BossCastMs)
+        {
+            for (uint32_t unitIndex : instance.Units)
+            {
+                Unit& unit = _units[unitIndex];
+                if (now >= unit.NextBossCastMs)
+                {
+                    unit.CastEndMs = std::max(unit.CastEndMs, now + _options.BossCastMs);
+                    unit.NextBossCastMs = now + _options.BossCastEveryMs;
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < instance.ParkedUnits.size();)
+        {
+            Unit& unit = _units[instance.ParkedUnits[i]];
+            if (!unit.Parked.empty() && now < unit.CastEndMs)
+            {
+                ++i;
+                continue;
+            }
+
+            instance.ParkedUnits[i] = instance.ParkedUnits.back();
+            instance.ParkedUnits.pop_back();
+
+            instance.Due.assign(unit.Parked.begin(), unit.Parked.end());
+            unit.Parked.clear();
+            Fire(instance, instance.Due, now);
+        }
+
+        instance.Due.clear();
+        _scheduler.Fired += instance.AbilityWheel.Advance(now, [&instance](Payload const& payload)
+        {
+            instance.Due.push_back(payload);
+        });
+
+        Fire(instance, instance.Due, now);
+    }
+
+    void Simulator::Run()
+    {
+        SetupUnits();
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t now = 0;
+
+        for (uint32_t pull = 0; pull < _options.Pulls; ++pull)
+        {
+            for (uint32_t i = 0; i < _units.size(); ++i)
+                EnterCombat(i, now);
+
+            uint64_t end = now + _options.DurationMs;
+            while (now < end)
+            {
+                now += _options.UpdateMs;
+                for (Instance& instance : _instances)
+                    Update(instance, now);
+                ++_scheduler.Updates;
+            }
+
+            for (uint32_t i = 0; i < _units.size(); ++i)
+                Evade(i);
+        }
+
+        _wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Simulator::Report() const
+    {
+        double minutes = _options.DurationMs / 60000.0 * _options.Pulls;
+
+        if (!_options.Quiet)
+        {
+            std::printf("%-8s %3s %7s %6s %6s %4s %9s %9s %8s %8s  %s\n", "Entry", "#", "Spell", "Target", "Chance", "Prio", "Fires/min", "Casts/min", "Parked", "NoTarget", "Comment");
+            for (auto const& [entry, stats] : _stats)
+            {
+                std::vector<SimAbility> const& program = _programs.at(entry);
+                double unitMinutes = minutes * _unitsPerEntry.at(entry);
+                for (uint32_t i = 0; i < program.size(); ++i)
+                {
+                    SimAbility const& ability = program[i];
+                    std::string comment = ability.Row->Comment.substr(0, 60);
+                    std::printf("%-8u %3u %7u %6u %5u%% %4u %9.2f %9.2f %8llu %8llu  %s\n", entry, i, ability.Row->Spell, ability.Target, ability.Chance, ability.Priority,
+                        stats[i].Fires / unitMinutes, stats[i].Casts / unitMinutes, (unsigned long long)stats[i].Parked, (unsigned long long)stats[i].NoTarget, comment.c_str());
+                }
+            }
+            std::printf("\n");
+        }
+
+        uint64_t events = _scheduler.Scheduled + _scheduler.Fired + _scheduler.Cancelled;
+        double simulatedSeconds = minutes * 60.0;
+        std::printf("Units %zu in %zu instances, raid size %u, %u pull(s) of %.1f s, update every %u ms\n",
+            _units.size(), _instances.size(), _options.RaidSize, _options.Pulls, _options.DurationMs / 1000.0, _options.UpdateMs);
+        std::printf("Scheduler: %llu scheduled, %llu fired, %llu cancelled, %llu parked, %llu stale, peak %zu pending in one instance\n",
+            (unsigned long long)_scheduler.Scheduled, (unsigned long long)_scheduler.Fired, (unsigned long long)_scheduler.Cancelled,
+            (unsigned long long)_scheduler.Parked, (unsigned long long)_scheduler.Stale, _scheduler.PeakPending);
+        std::printf("Scheduler events: %.1f per simulated second, %.0f per wall second (%llu instance updates in %.3f s, %.1f ns per update)\n",
+            simulatedSeconds > 0 ? events / simulatedSeconds : 0.0, _wallSeconds > 0 ? events / _wallSeconds : 0.0,
+            (unsigned long long)(_scheduler.Updates * _instances.size()), _wallSeconds,
+            _scheduler.Updates ? _wallSeconds * 1e9 / (_scheduler.Updates * _instances.size()) : 0.0);
+    }
+
+    void PrintUsage(char const* name)
+    {
+        std::printf("Usage: %s [options]\n"
+            "  --sql <dir>                  SQL files to load (default %s)\n"
+            "  --entry <id>                 simulate this creature entry, repeatable (default: all)\n"
+            "  --units <n>                  units in total, entries are assigned round robin (default: one per entry)\n"
+            "  --units-per-instance <n>     units sharing one ability wheel (default 1)\n"
+            "  --raid <n>                   players fighting each unit, up to %u (default 25)\n"
+            "  --duration <s>               length of a pull in seconds (default 300)\n"
+            "  --pulls <n>                  pulls in a row, Chance is rolled again for every pull (default 1)\n"
+            "  --update-ms <ms>             map update interval (default 10)\n"
+            "  --cast-ms <ms>               cast time of abilities with TriggeredCast 0 (default 1500)\n"
+            "  --boss-cast-ms <ms>          the unit casts its own spells for this long ...\n"
+            "  --boss-cast-every-ms <ms>    ... this often, blocking the Mythicmode AI (default off)\n"
+            "  --spread <yards>             radius the raid is spread over around the unit (default 30)\n"
+            "  --move-ms <ms>               the raid takes new positions this often (default 2000)\n"
+            "  --seed <n>                   random seed (default 1)\n"
+            "  --list                       only list the loaded and rejected rows\n"
+            "  --quiet                      skip the per-ability report\n", name, MYTHICMODE_SIM_SQL_DIR, MAX_RAID_SIZE);
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto next = [&]() -> char const*
+            {
+                if (i + 1 >= argc)
+                {
+                    std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                    std::exit(1);
+                }
+                return argv[++i];
+            };
+            auto number = [&]() { return uint32_t(std::strtoul(next(), nullptr, 10)); };
+
+            if (arg == "--sql")
+                options.SqlDir = next();
+            else if (arg == "--entry")
+                options.Entries.push_back(number());
+            else if (arg == "--units")
+                options.Units = number();
+            else if (arg == "--units-per-instance")
+                options.UnitsPerInstance = number();
+            else if (arg == "--raid")
+                options.RaidSize = number();
+            else if (arg == "--duration")
+                options.DurationMs = number() * 1000;
+            else if (arg == "--pulls")
+                options.Pulls = number();
+            else if (arg == "--update-ms")
+                options.UpdateMs = number();
+            else if (arg == "--cast-ms")
+                options.CastMs = number();
+            else if (arg == "--boss-cast-ms")
+                options.BossCastMs = number();
+            else if (arg == "--boss-cast-every-ms")
+                options.BossCastEveryMs = number();
+            else if (arg == "--spread")
+                options.Spread = float(std::strtod(next(), nullptr));
+            else if (arg == "--move-ms")
+                options.MoveMs = number();
+            else if (arg == "--seed")
+                options.Seed = number();
+            else if (arg == "--list")
+                options.List = true;
+            else if (arg == "--quiet")
+                options.Quiet = true;
+            else if (arg == "--help" || arg == "-h")
+            {
+                PrintUsage(argv[0]);
+                std::exit(0);
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+                PrintUsage(argv[0]);
+                return false;
+            }
+        }
+
+        if (options.RaidSize > MAX_RAID_SIZE)
+        {
+            std::fprintf(stderr, "--raid is limited to %u\n", MAX_RAID_SIZE);
+            return false;
+        }
+
+        if (!options.UpdateMs)
+        {
+            std::fprintf(stderr, "--update-ms has to be above 0\n");
+            return false;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+
+    MythicmodeSqlLoader loader;
+    if (!loader.LoadDirectory(options.SqlDir))
+    {
+        for (std::string const& error : loader.Errors)
+            std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    for (std::string const& error : loader.Errors)
+        std::fprintf(stderr, "SQL: %s\n", error.c_str());
+
+    std::map<uint32_t, std::vector<SimAbility> > programs;
+    uint32_t rejected = 0;
+    for (MythicmodeSqlRow const& row : loader.Rows)
+    {
+        if (!row.Enabled)
+            continue;
+
+        SimAbility ability;
+        std::string error;
+        if (!Compile(row, ability, error))
+        {
+            std::fprintf(stderr, "Rejected %s: CreatureEntry %u Spell %u: %s\n", row.Source.c_str(), row.CreatureEntry, row.Spell, error.c_str());
+            ++rejected;
+            continue;
+        }
+
+        programs[row.CreatureEntry].push_back(ability);
+    }
+
+    std::printf("Loaded %zu rows from %s, %zu creatures with abilities, %u rows rejected\n\n", loader.Rows.size(), options.SqlDir.c_str(), programs.size(), rejected);
+
+    if (options.List)
+    {
+        for (auto const& [entry, program] : programs)
+            for (uint32_t i = 0; i < program.size(); ++i)
+                std::printf("%-8u %3u %7u target %2u chance %3u%% delay %6llu cooldown %6llu %s  %s\n", entry, i, program[i].Row->Spell, program[i].Target, program[i].Chance,
+                    (unsigned long long)program[i].Delay, (unsigned long long)program[i].Cooldown, program[i].Repeat ? "repeat" : "once  ", program[i].Row->Comment.c_str());
+        return 0;
+    }
+
+    for (uint32_t entry : options.Entries)
+    {
+        if (!programs.count(entry))
+        {
+            std::fprintf(stderr, "Creature entry %u has no enabled abilities\n", entry);
+            return 1;
+        }
+    }
+
+    if (programs.empty())
+    {
+        std::fprintf(stderr, "Nothing to simulate\n");
+        return 1;
+    }
+
+    Simulator simulator(options, programs);
+    simulator.Run();
+    simulator.Report();
+    return 0;
+}